@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2011 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cppbugs/mcmc.deterministic.hpp>
+
+namespace cppbugs {
+
+  // value[i] = x[index[i]], i.e. a.elem(group) as a node
+  // the index is bounds checked once and compressed into runs of equal
+  // consecutive entries, so each jump is a segmented broadcast into value
+  template<typename T, typename U, typename V>
+  class Gather : public Deterministic<T> {
+    const U& x_;
+    // run k fills [run_start_[k], run_start_[k+1]) with x_[run_index_[k]]
+    std::vector<size_t> run_start_, run_index_;
+  public:
+    Gather(T& value, const U& x, const V& index): Deterministic<T>(value), x_(x) {
+      for(size_t i = 0; i < index.n_elem; i++) {
+        if(index[i] >= x_.n_elem) {
+          throw std::logic_error("ERROR: gather index out of bounds.");
+        }
+        if(i == 0 || index[i] != index[i-1]) {
+          run_start_.push_back(i);
+          run_index_.push_back(index[i]);
+        }
+      }
+      run_start_.push_back(index.n_elem);
+      Deterministic<T>::value.set_size(index.n_elem, 1);
+      jump_inplace();
+    }
+    void jump_inplace() {
+      double* out = Deterministic<T>::value.memptr();
+      for(size_t k = 0; k < run_index_.size(); k++) {
+        std::fill(out + run_start_[k], out + run_start_[k+1], x_[run_index_[k]]);
+      }
+    }
+    void jump(RngBase& rng) {
+      jump_inplace();
+    }
+  };
+} // namespace cppbugs
@@ -27,7 +27,9 @@ namespace cppbugs {
     const U& a_;
     std::function<T(const U&)> f_;
   public:
-    Lambda1(T& value, std::function<const T(const U&)> f, const U& a): Deterministic<T>(value), f_(f), a_(a) {}
+    Lambda1(T& value, std::function<const T(const U&)> f, const U& a): Deterministic<T>(value), a_(a), f_(f) {
+      Deterministic<T>::value = f_(a_);
+    }
     void jump(RngBase& rng) {
       Deterministic<T>::value = f_(a_);
     }
@@ -36,10 +38,10 @@ namespace cppbugs {
   template<typename T, typename U, typename V>
   class Lambda2 : public Deterministic<T> {
     const U& a_;
-    const U& b_;
+    const V& b_;
     std::function<T(const U&,const V&)> f_;
   public:
-    Lambda2(T& value, std::function<T(const U&,const V&)> f, const U& a,const V& b): Deterministic<T>(value), f_(f), a_(a), b_(b) {
+    Lambda2(T& value, std::function<T(const U&,const V&)> f, const U& a,const V& b): Deterministic<T>(value), a_(a), b_(b), f_(f) {
       Deterministic<T>::value = f_(a_,b_);
     }
     void jump(RngBase& rng) {
@@ -54,7 +56,7 @@ namespace cppbugs {
     const W& c_;
     std::function<T(const U&,const V&,const W&)> f_;
   public:
-    Lambda3(T& value, std::function<T(const U&,const V&,const W&)> f, const U& a,const V& b,const W& c): Deterministic<T>(value), f_(f), a_(a), b_(b), c_(c) {
+    Lambda3(T& value, std::function<T(const U&,const V&,const W&)> f, const U& a,const V& b,const W& c): Deterministic<T>(value), a_(a), b_(b), c_(c), f_(f) {
       Deterministic<T>::value = f_(a_,b_,c_);
     }
     void jump(RngBase& rng) {
@@ -70,7 +72,7 @@ namespace cppbugs {
     const X& d_;
     std::function<T(const U&,const V&,const W&,const X&)> f_;
   public:
-    Lambda4(T& value, std::function<T(const U&,const V&,const W&,const X&)> f, const U& a,const V& b,const W& c, const X& d): Deterministic<T>(value), f_(f), a_(a), b_(b), c_(c), d_(d) {
+    Lambda4(T& value, std::function<T(const U&,const V&,const W&,const X&)> f, const U& a,const V& b,const W& c, const X& d): Deterministic<T>(value), a_(a), b_(b), c_(c), d_(d), f_(f) {
       Deterministic<T>::value = f_(a_,b_,c_,d_);
     }
     void jump(RngBase& rng) {
@@ -78,4 +80,65 @@ namespace cppbugs {
     }
   };
 
+  // in-place lambdas: F is any functor callable as f(T& out, const U& a, ...)
+  // it writes into the node's existing buffer, so nothing is returned by value
+  // and (unlike std::function) the call can be inlined
+  template<typename T, typename F, typename U>
+  class InPlaceLambda1 : public Deterministic<T> {
+    F f_;
+    const U& a_;
+  public:
+    InPlaceLambda1(T& value, F f, const U& a): Deterministic<T>(value), f_(f), a_(a) {
+      f_(Deterministic<T>::value,a_);
+    }
+    void jump(RngBase& rng) {
+      f_(Deterministic<T>::value,a_);
+    }
+  };
+
+  template<typename T, typename F, typename U, typename V>
+  class InPlaceLambda2 : public Deterministic<T> {
+    F f_;
+    const U& a_;
+    const V& b_;
+  public:
+    InPlaceLambda2(T& value, F f, const U& a, const V& b): Deterministic<T>(value), f_(f), a_(a), b_(b) {
+      f_(Deterministic<T>::value,a_,b_);
+    }
+    void jump(RngBase& rng) {
+      f_(Deterministic<T>::value,a_,b_);
+    }
+  };
+
+  template<typename T, typename F, typename U, typename V, typename W>
+  class InPlaceLambda3 : public Deterministic<T> {
+    F f_;
+    const U& a_;
+    const V& b_;
+    const W& c_;
+  public:
+    InPlaceLambda3(T& value, F f, const U& a, const V& b, const W& c): Deterministic<T>(value), f_(f), a_(a), b_(b), c_(c) {
+      f_(Deterministic<T>::value,a_,b_,c_);
+    }
+    void jump(RngBase& rng) {
+      f_(Deterministic<T>::value,a_,b_,c_);
+    }
+  };
+
+  template<typename T, typename F, typename U, typename V, typename W, typename X>
+  class InPlaceLambda4 : public Deterministic<T> {
+    F f_;
+    const U& a_;
+    const V& b_;
+    const W& c_;
+    const X& d_;
+  public:
+    InPlaceLambda4(T& value, F f, const U& a, const V& b, const W& c, const X& d): Deterministic<T>(value), f_(f), a_(a), b_(b), c_(c), d_(d) {
+      f_(Deterministic<T>::value,a_,b_,c_,d_);
+    }
+    void jump(RngBase& rng) {
+      f_(Deterministic<T>::value,a_,b_,c_,d_);
+    }
+  };
+
 } // namespace cppbugs
@@ -28,10 +28,26 @@ namespace cppbugs {
     const W& groups_;
   public:
     LinearGrouped(T& x, const U& X, const V& b, const W& groups): Deterministic<T>(x), X_(X), b_(b), groups_(groups) {
-      Deterministic<T>::value = sum(X_ % b_.rows(groups_),1);
+      if(groups_.n_elem != X_.n_rows || (groups_.n_elem && arma::max(groups_) >= b_.n_rows)) {
+        throw std::logic_error("ERROR: groups do not match X and b.");
+      }
+      Deterministic<T>::value.set_size(X_.n_rows, 1);
+      jump_inplace();
+    }
+    // same as sum(X_ % b_.rows(groups_),1), but without materializing b_.rows(groups_)
+    // groups are checked once in the ctor, so the lookups here are unchecked
+    void jump_inplace() {
+      T& value = Deterministic<T>::value;
+      value.set_size(X_.n_rows, 1);
+      value.zeros();
+      for(size_t j = 0; j < X_.n_cols; j++) {
+        for(size_t i = 0; i < X_.n_rows; i++) {
+          value[i] += X_.at(i,j) * b_.at(groups_[i],j);
+        }
+      }
     }
     void jump(RngBase& rng) {
-      Deterministic<T>::value = sum(X_ % b_.rows(groups_),1);
+      jump_inplace();
     }
   };
 } // namespace cppbugs
@@ -29,6 +29,7 @@ namespace cppbugs {
     Linear(T& x, const U& X, const V& b): Deterministic<T>(x), X_(X), b_(b) {
       Deterministic<T>::value = X_ * b_;
     }
+    // the product is evaluated directly into value's existing buffer (no temporary)
     void jump(RngBase& rng) {
       Deterministic<T>::value = X_ * b_;
     }
@@ -28,10 +28,13 @@ namespace cppbugs {
     const W& b_;
   public:
     LinearWithConst(T& x, const U& X, const V& a, const W& b): Deterministic<T>(x), X_(X), a_(a), b_(b) {
-      Deterministic<T>::value = a_ + X_ * b_;
+      Deterministic<T>::value = X_ * b_;
+      Deterministic<T>::value += a_;
     }
+    // a_ + X_ * b_ would materialize the product in a temporary
     void jump(RngBase& rng) {
-      Deterministic<T>::value = a_ + X_ * b_;
+      Deterministic<T>::value = X_ * b_;
+      Deterministic<T>::value += a_;
     }
   };
 } // namespace cppbugs
@@ -27,10 +27,16 @@ namespace cppbugs {
     const V& b_;
   public:
     Logistic(T& x, const U& X, const V& b): Deterministic<T>(x), X_(X), b_(b) {
-      Deterministic<T>::value = 1/(1+exp(-X_*b_));
+      jump_inplace();
+    }
+    // product goes straight into value, then the link is applied elementwise over it
+    void jump_inplace() {
+      T& value = Deterministic<T>::value;
+      value = X_ * b_;
+      value = 1/(1+exp(-value));
     }
     void jump(RngBase& rng) {
-      Deterministic<T>::value = 1/(1+exp(-X_*b_));
+      jump_inplace();
     }
   };
 } // namespace cppbugs
@@ -27,10 +27,29 @@ namespace cppbugs {
     const V& y_hat_;
   public:
     Rsquared(T& x, const U& y, const V& y_hat): Deterministic<T>(x), y_(y), y_hat_(y_hat) {
-      Deterministic<T>::value = as_scalar(1 - var(y_ - y_hat_) / var(y_));
+      jump_inplace();
+    }
+    // 1 - var(y_ - y_hat_) / var(y_) computed in two passes w/o temporaries
+    void jump_inplace() {
+      const size_t n = y_.n_elem;
+      double y_mean(0), e_mean(0);
+      for(size_t i = 0; i < n; i++) {
+        y_mean += y_[i];
+        e_mean += y_[i] - y_hat_[i];
+      }
+      y_mean /= n;
+      e_mean /= n;
+      double y_ss(0), e_ss(0);
+      for(size_t i = 0; i < n; i++) {
+        const double dy = y_[i] - y_mean;
+        const double de = y_[i] - y_hat_[i] - e_mean;
+        y_ss += dy * dy;
+        e_ss += de * de;
+      }
+      Deterministic<T>::value = 1 - e_ss / y_ss;
     }
     void jump(RngBase& rng) {
-      Deterministic<T>::value = as_scalar(1 - var(y_ - y_hat_) / var(y_));
+      jump_inplace();
     }
   };
 } // namespace cppbugs
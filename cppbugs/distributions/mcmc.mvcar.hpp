@@ -44,6 +44,8 @@ namespace cppbugs {
       }
     }
 
+    size_t packed_size() const { return 0; }
+
     // modified jumper to preserve mv car constraints
     void jump(RngBase& rng) {
     }
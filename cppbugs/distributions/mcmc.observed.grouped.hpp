@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <limits>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/mcmc.observed.hpp>
+#include <cppbugs/mcmc.math.hpp>
+#include <cppbugs/mcmc.utils.hpp>
+
+// observed nodes whose parameters are constant within groups
+// groups[i] gives the group of observation i (as for LinearGrouped), the parameters
+// are indexed by group, and the log likelihood is evaluated from per-group
+// sufficient statistics computed once from the (fixed) data, i.e. O(groups) per step
+namespace cppbugs {
+
+  template<typename T, typename W>
+  size_t check_groups(const T& x, const W& groups) {
+    if(groups.n_elem != x.n_elem) {
+      throw std::logic_error("ERROR: groups must have one entry per observation.");
+    }
+    return groups.n_elem ? arma::max(groups) + 1 : 0;
+  }
+
+  template<typename U>
+  void check_group_params(const U& p, const size_t n_groups) {
+    if(dim_size(p) != 1 && dim_size(p) < n_groups) {
+      throw std::logic_error("ERROR: group parameters have fewer elements than there are groups.");
+    }
+  }
+
+  template<typename T, typename U, typename V, typename W>
+  class ObservedNormalGrouped : public Observed<T> {
+  private:
+    const U& mu_;
+    const V& tau_;
+    // per group count, sum and sum of squares
+    arma::vec n_, sum_, sum_sq_;
+  public:
+    ObservedNormalGrouped(const T& value, const U& mu, const V& tau, const W& groups): Observed<T>(value), mu_(mu), tau_(tau) {
+      const size_t n_groups = check_groups(value, groups);
+      check_group_params(mu_, n_groups);
+      check_group_params(tau_, n_groups);
+      n_.zeros(n_groups);
+      sum_.zeros(n_groups);
+      sum_sq_.zeros(n_groups);
+      for(size_t i = 0; i < value.n_elem; i++) {
+        n_[groups[i]] += 1;
+        sum_[groups[i]] += value[i];
+        sum_sq_[groups[i]] += square(value[i]);
+      }
+    }
+    double loglik() const {
+      double ans(0);
+      for(size_t g = 0; g < n_.n_elem; g++) {
+        const double mu_g = element(mu_,g), tau_g = element(tau_,g);
+        // sum_i (y_i - mu)^2 = sum_sq - 2 mu sum + n mu^2
+        ans += n_[g] * 0.5*log_approx(0.5*tau_g/arma::datum::pi) - 0.5 * tau_g * (sum_sq_[g] - 2 * mu_g * sum_[g] + n_[g] * square(mu_g));
+      }
+      return ans;
+    }
+  };
+
+  template<typename T, typename U, typename W>
+  class ObservedPoissonGrouped : public Observed<T> {
+  private:
+    const U& mu_;
+    arma::vec n_, sum_;
+    double factln_sum_;
+    bool bad_data_;
+  public:
+    ObservedPoissonGrouped(const T& value, const U& mu, const W& groups): Observed<T>(value), mu_(mu), factln_sum_(0), bad_data_(false) {
+      const size_t n_groups = check_groups(value, groups);
+      check_group_params(mu_, n_groups);
+      n_.zeros(n_groups);
+      sum_.zeros(n_groups);
+      for(size_t i = 0; i < value.n_elem; i++) {
+        if(value[i] < 0) { bad_data_ = true; }
+        n_[groups[i]] += 1;
+        sum_[groups[i]] += value[i];
+        factln_sum_ += arma::factln(static_cast<int>(value[i]));
+      }
+    }
+    double loglik() const {
+      if(bad_data_) { return -std::numeric_limits<double>::infinity(); }
+      double ans(-factln_sum_);
+      for(size_t g = 0; g < n_.n_elem; g++) {
+        const double mu_g = element(mu_,g);
+        if(mu_g < 0) { return -std::numeric_limits<double>::infinity(); }
+        ans += sum_[g] * log_approx(mu_g) - n_[g] * mu_g;
+      }
+      return ans;
+    }
+  };
+
+  template<typename T, typename U, typename V, typename W>
+  class ObservedBinomialGrouped : public Observed<T> {
+  private:
+    const V& p_;
+    // per group successes and failures
+    arma::vec successes_, failures_;
+    double factln_sum_;
+    bool bad_data_;
+  public:
+    ObservedBinomialGrouped(const T& value, const U& n, const V& p, const W& groups): Observed<T>(value), p_(p), factln_sum_(0), bad_data_(false) {
+      const size_t n_groups = check_groups(value, groups);
+      check_group_params(p_, n_groups);
+      successes_.zeros(n_groups);
+      failures_.zeros(n_groups);
+      for(size_t i = 0; i < value.n_elem; i++) {
+        const int x_i = value[i], n_i = element(n,i);
+        if(x_i < 0 || x_i > n_i) { bad_data_ = true; }
+        successes_[groups[i]] += x_i;
+        failures_[groups[i]] += n_i - x_i;
+        factln_sum_ += arma::factln(n_i) - arma::factln(x_i) - arma::factln(n_i - x_i);
+      }
+    }
+    double loglik() const {
+      if(bad_data_) { return -std::numeric_limits<double>::infinity(); }
+      double ans(factln_sum_);
+      for(size_t g = 0; g < successes_.n_elem; g++) {
+        const double p_g = element(p_,g);
+        if(p_g <= 0 || p_g >= 1) { return -std::numeric_limits<double>::infinity(); }
+        ans += successes_[g] * log_approx(p_g) + failures_[g] * log_approx(1 - p_g);
+      }
+      return ans;
+    }
+  };
+
+} // namespace cppbugs
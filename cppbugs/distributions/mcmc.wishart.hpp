@@ -29,7 +29,6 @@ namespace cppbugs {
   private:
     const U& tau_;
     const V& n_;
-    const bool destory_tau_, destory_n_;
 
     // element indices for lower diagonal
     const arma::uvec ld_elems_;
@@ -52,7 +51,7 @@ namespace cppbugs {
     }
 
   public:
-    Wishart(T& value, const U& tau, const V& n): DynamicStochastic<T>(value), tau_(tau), n_(n), destory_tau_(false), destory_n_(false), ld_elems_(lower_diag(value.n_cols)), LL(arma::zeros<arma::mat>(value.n_rows, value.n_cols)) {
+    Wishart(T& value, const U& tau, const V& n): DynamicStochastic<T>(value), tau_(tau), n_(n), ld_elems_(lower_diag(value.n_cols)), LL(arma::zeros<arma::mat>(value.n_rows, value.n_cols)) {
       if(value.n_rows != tau_.n_rows || value.n_cols != tau_.n_cols) {
         throw std::logic_error("ERROR: dimensions of initial value do not match tau");
       }
@@ -76,6 +75,8 @@ namespace cppbugs {
       R = R.t();
       R_log_diag = log(diagvec(R));
       R_offdiag = R.elem(ld_elems_);
+      R_log_diag_old = R_log_diag;
+      R_offdiag_old = R_offdiag;
 
       // recover X to test
       LL.diag() = exp(R_log_diag);
@@ -86,37 +87,55 @@ namespace cppbugs {
       }
     }
 
-    // modified revert so that it can revert, R components
-    void preserve() {
-      R_log_diag_old = R_log_diag;
-      R_offdiag_old = R_offdiag;
-      DynamicStochastic<T>::preserve();
-    }
+    // the cholesky components are double buffered along with value (see
+    // Dynamic): nothing is copied on preserve, a jump writes into the _old
+    // buffers and swaps, revert swaps back
     void revert() {
-      R_log_diag = R_log_diag_old;
-      R_offdiag = R_offdiag_old;
+      if(Dynamic<T>::saved_) {
+        R_log_diag.swap(R_log_diag_old);
+        R_offdiag.swap(R_offdiag_old);
+      }
       DynamicStochastic<T>::revert();
     }
 
+    // jumps happen on the cholesky factor, so value can't be moved in flat space
+    size_t packed_size() const { return 0; }
+
+    // the factor is saved as is (recomputing it from value wouldn't be bit for bit)
+    void save_value(BinaryWriter& out) const {
+      DynamicStochastic<T>::save_value(out);
+      out.put(R_log_diag);
+      out.put(R_offdiag);
+    }
+    void load_value(BinaryReader& in) {
+      DynamicStochastic<T>::load_value(in);
+      R_log_diag = in.get_vec();
+      R_offdiag = in.get_vec();
+    }
+
     // modified jumper to preserve symetric positive definite
     void jump(RngBase& rng) {
       //positive_jump_impl(rng, DynamicStochastic<T>::value, DynamicStochastic<T>::scale_);
+      const bool saved = Dynamic<T>::saved_;
+      arma::vec& log_diag = saved ? R_log_diag : R_log_diag_old;
+      arma::vec& offdiag = saved ? R_offdiag : R_offdiag_old;
       for(size_t i = 0; i < R_log_diag.n_elem; ++i) {
-        R_log_diag[i] += rng.normal() * DynamicStochastic<T>::scale_;
+        log_diag[i] = R_log_diag[i] + rng.normal() * DynamicStochastic<T>::scale_;
       }
       for(size_t i = 0; i < R_offdiag.n_elem; ++i) {
-        R_offdiag[i] += rng.normal() * DynamicStochastic<T>::scale_;
+        offdiag[i] = R_offdiag[i] + rng.normal() * DynamicStochastic<T>::scale_;
+      }
+      if(!saved) {
+        R_log_diag.swap(R_log_diag_old);
+        R_offdiag.swap(R_offdiag_old);
       }
       LL.diag() = exp(R_log_diag);
       LL.elem(ld_elems_) = R_offdiag;
-      DynamicStochastic<T>::value = LL * LL.t();
+      DynamicStochastic<T>::spare() = LL * LL.t();
+      DynamicStochastic<T>::commit();
     }
 
-    ~Wishart() {
-      if(destory_tau_) { delete &tau_; }
-      if(destory_n_) { delete &n_; }
-    }
-    const double loglik() const { return wishart_logp(DynamicStochastic<T>::value,tau_,n_); }
+    double loglik() const { return wishart_logp(DynamicStochastic<T>::value,tau_,n_); }
   };
 
 } // namespace cppbugs
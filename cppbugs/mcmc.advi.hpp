@@ -0,0 +1,302 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/mcmc.rng.base.hpp>
+#include <cppbugs/mcmc.model.hpp>
+
+namespace cppbugs {
+
+  // gaussian q(z) = N(mu, L L') on an unconstrained space, mapped onto the
+  // model's flat state element by element, according to each node's support:
+  //   (-inf,inf): x = z       (a,inf): x = a + exp(z)
+  //   (-inf,b):   x = b - exp(z)   (a,b): x = a + (b - a) / (1 + exp(-z))
+  class VariationalApproximation {
+  private:
+    // log(1 + exp(t)) without overflow
+    static double softplus(const double t) {
+      return t > 0 ? t + log1p(exp(-t)) : log1p(exp(t));
+    }
+  public:
+    arma::vec lower, upper, mu;
+    arma::mat L; // lower triangular (diagonal when mean field)
+    bool full_rank;
+
+    VariationalApproximation(): full_rank(false) {}
+
+    // x = T(z), returns log |det dT/dz|
+    double constrain(const arma::vec& z, arma::vec& x) const {
+      x.set_size(z.n_elem);
+      double log_jacobian(0);
+      for(size_t i = 0; i < z.n_elem; i++) {
+        const bool has_lower = lower[i] > -std::numeric_limits<double>::infinity();
+        const bool has_upper = upper[i] < std::numeric_limits<double>::infinity();
+        if(has_lower && has_upper) {
+          x[i] = lower[i] + (upper[i] - lower[i]) / (1 + exp(-z[i]));
+          log_jacobian += log(upper[i] - lower[i]) - softplus(-z[i]) - softplus(z[i]);
+        } else if(has_lower) {
+          x[i] = lower[i] + exp(z[i]);
+          log_jacobian += z[i];
+        } else if(has_upper) {
+          x[i] = upper[i] - exp(z[i]);
+          log_jacobian += z[i];
+        } else {
+          x[i] = z[i];
+        }
+      }
+      return log_jacobian;
+    }
+
+    // z = T^-1(x), values on or outside a bound are pulled just inside it
+    void unconstrain(const arma::vec& x, arma::vec& z) const {
+      const double tiny = 1e-12;
+      z.set_size(x.n_elem);
+      for(size_t i = 0; i < x.n_elem; i++) {
+        const bool has_lower = lower[i] > -std::numeric_limits<double>::infinity();
+        const bool has_upper = upper[i] < std::numeric_limits<double>::infinity();
+        if(has_lower && has_upper) {
+          const double p = std::min(std::max((x[i] - lower[i]) / (upper[i] - lower[i]), tiny), 1 - tiny);
+          z[i] = log(p / (1 - p));
+        } else if(has_lower) {
+          z[i] = log(std::max(x[i] - lower[i], tiny));
+        } else if(has_upper) {
+          z[i] = log(std::max(upper[i] - x[i], tiny));
+        } else {
+          z[i] = x[i];
+        }
+      }
+    }
+
+    // one independent draw of the flat state
+    void draw(RngBase& rng, arma::vec& x) const {
+      const size_t d = mu.n_elem;
+      arma::vec eta(d), z(mu);
+      for(size_t i = 0; i < d; i++) { eta[i] = rng.normal(); }
+      for(size_t i = 0; i < d; i++) {
+        if(full_rank) {
+          for(size_t j = 0; j <= i; j++) { z[i] += L(i, j) * eta[j]; }
+        } else {
+          z[i] += L(i, i) * eta[i];
+        }
+      }
+      constrain(z, x);
+    }
+
+    // the state at the mean of q
+    void center(arma::vec& x) const { constrain(mu, x); }
+  };
+
+  // finite difference variational inference: the algorithm of automatic
+  // differentiation variational inference (ADVI, Kucukelbir et al. 2017) with
+  // the gradient taken numerically.  fits a mean field or full rank gaussian
+  // in the unconstrained space by stochastic gradient ascent on the elbo,
+  // with reparameterised gradients averaged over samples draws per iteration
+  // and the adaptive step size sequence from the paper (see step_size for
+  // one change).  the node graph has
+  // no derivatives, so the gradient of log p(T(z)) + log |det dT/dz| is taken
+  // by central differences: 2 d + 1 logp evaluations per draw, where automatic
+  // differentiation costs a small multiple of one, and only as accurate as the
+  // differences.  it suits models with a modest number of parameters and a
+  // smooth logp
+  //
+  //   ADVI advi(m, rng);          // m: a linked MCModel
+  //   advi.fit(1e4);
+  //   advi.sample(1e4);           // tallies independent draws from q
+  //
+  // supports come from the distributions (Uniform, Gamma, Beta, Exponential)
+  // and are read once, so bounds must not depend on other parameters.  q is
+  // over the flat state, so every parameter must be packable
+  class ADVI {
+  private:
+    MCModel& model_;
+    RngBase& rng_;
+    const int samples_;
+    const double eta_;
+    VariationalApproximation q_;
+    arma::vec omega_;            // log sd, mean field
+    arma::vec s_mu_, s_omega_;   // running squared gradients, for step sizes
+    arma::mat s_L_;
+    int iteration_;
+    double elbo_;
+
+    // log p(T(z)) + log |det dT/dz|
+    double target(const arma::vec& z) {
+      arma::vec x;
+      const double log_jacobian = q_.constrain(z, x);
+      return model_.logp_at(x) + log_jacobian;
+    }
+
+    double gradient(const arma::vec& z, arma::vec& g) {
+      g.set_size(z.n_elem);
+      arma::vec shifted(z);
+      for(size_t j = 0; j < z.n_elem; j++) {
+        const double h = 1e-5 * std::max(1.0, fabs(z[j]));
+        shifted[j] = z[j] + h;
+        const double up = target(shifted);
+        shifted[j] = z[j] - h;
+        const double down = target(shifted);
+        shifted[j] = z[j];
+        g[j] = (up - down) / (2 * h);
+      }
+      return target(z);
+    }
+
+    // scaled by the running mean square of the earlier gradients: including g
+    // itself shrinks the large draws more than the small ones, which moves the
+    // fixed point when the gradient noise is skewed
+    double step_size(const double g, double& s) const {
+      const double scale = iteration_ == 1 ? g * g : s;
+      s = iteration_ == 1 ? g * g : 0.1 * g * g + 0.9 * s;
+      return eta_ * pow(iteration_, -0.5 + 1e-16) / (1 + sqrt(scale));
+    }
+
+    static bool finite(const arma::vec& x) {
+      for(size_t i = 0; i < x.n_elem; i++) {
+        if(!std::isfinite(x[i])) { return false; }
+      }
+      return true;
+    }
+  public:
+    ADVI(MCModel& model, RngBase& rng, const bool full_rank = false, const int samples = 1, const double eta = 0.1):
+      model_(model), rng_(rng), samples_(samples), eta_(eta), iteration_(0), elbo_(-std::numeric_limits<double>::infinity()) {
+      if(samples < 1 || !(eta > 0)) {
+        throw std::logic_error("ERROR: advi needs samples >= 1 and eta > 0.");
+      }
+      if(!model_.state_complete()) {
+        throw std::logic_error("ERROR: advi fits the flat state, so every parameter must be packable (no integer, Wishart or MVCAR nodes).");
+      }
+      arma::vec x;
+      model_.state_support(q_.lower, q_.upper);
+      model_.getState(x);
+      q_.unconstrain(x, q_.mu);
+      const size_t d = x.n_elem;
+      q_.full_rank = full_rank;
+      q_.L = arma::eye(d, d);
+      omega_.zeros(d);
+      s_mu_.zeros(d);
+      s_omega_.zeros(d);
+      if(full_rank) { s_L_.zeros(d, d); }
+    }
+
+    const VariationalApproximation& approximation() const { return q_; }
+    double elbo() const { return elbo_; }
+    int iterations() const { return iteration_; }
+
+    // one gradient step, returns the elbo estimate at the starting point
+    double step() {
+      ++iteration_;
+      const size_t d = q_.mu.n_elem;
+      const bool full_rank = q_.full_rank;
+      arma::vec g_mu(d), g_omega(d), eta(d), z, g;
+      arma::mat g_L;
+      g_mu.zeros();
+      g_omega.zeros();
+      if(full_rank) { g_L.zeros(d, d); }
+      double value(0);
+      int used(0);
+      for(int s = 0; s < samples_; s++) {
+        for(size_t i = 0; i < d; i++) { eta[i] = rng_.normal(); }
+        z = q_.mu;
+        for(size_t i = 0; i < d; i++) {
+          if(full_rank) {
+            for(size_t j = 0; j <= i; j++) { z[i] += q_.L(i, j) * eta[j]; }
+          } else {
+            z[i] += exp(omega_[i]) * eta[i];
+          }
+        }
+        const double t = gradient(z, g);
+        // draws that leave the support carry no gradient information
+        if(!std::isfinite(t) || !finite(g)) { continue; }
+        ++used;
+        value += t;
+        g_mu += g;
+        for(size_t i = 0; i < d; i++) {
+          if(full_rank) {
+            for(size_t j = 0; j <= i; j++) { g_L(i, j) += g[i] * eta[j]; }
+          } else {
+            g_omega[i] += g[i] * eta[i] * exp(omega_[i]);
+          }
+        }
+      }
+      if(used == 0) {
+        elbo_ = -std::numeric_limits<double>::infinity();
+        return elbo_;
+      }
+      // averages, plus the gradient of the entropy
+      double entropy(0);
+      for(size_t i = 0; i < d; i++) {
+        g_mu[i] /= used;
+        q_.mu[i] += step_size(g_mu[i], s_mu_[i]) * g_mu[i];
+        if(full_rank) {
+          entropy += log(fabs(q_.L(i, i)));
+          for(size_t j = 0; j <= i; j++) {
+            double& gij = g_L(i, j);
+            gij = gij / used + (i == j ? 1 / q_.L(i, i) : 0);
+            q_.L(i, j) += step_size(gij, s_L_(i, j)) * gij;
+          }
+        } else {
+          entropy += omega_[i];
+          g_omega[i] = g_omega[i] / used + 1;
+          omega_[i] += step_size(g_omega[i], s_omega_[i]) * g_omega[i];
+          q_.L(i, i) = exp(omega_[i]);
+        }
+      }
+      elbo_ = value / used + entropy + 0.5 * d * (1 + log(2 * arma::datum::pi));
+      return elbo_;
+    }
+
+    // steps until the mean elbo over successive windows of eval_every
+    // iterations changes by less than tolerance (relative), or max_iterations;
+    // leaves the model at the mean of q and returns the iterations taken.
+    // the step sizes decay, so a fit still far from the optimum can change
+    // little per window: a loose tolerance or a short window stops it early
+    int fit(const int max_iterations, const double tolerance = 0.01, const int eval_every = 100) {
+      double window(0), previous(std::numeric_limits<double>::quiet_NaN());
+      int i = 1;
+      for(; i <= max_iterations; i++) {
+        window += step();
+        if(i % eval_every == 0) {
+          const double current = window / eval_every;
+          window = 0;
+          if(std::isfinite(current) && std::isfinite(previous) && fabs(current - previous) < tolerance * fabs(current)) { break; }
+          previous = current;
+        }
+      }
+      arma::vec x;
+      q_.center(x);
+      model_.setState(x);
+      return std::min(i, max_iterations);
+    }
+
+    // tally draws independent draws from q through the model's trackers
+    void sample(const int draws) {
+      arma::vec x;
+      for(int i = 0; i < draws; i++) {
+        q_.draw(rng_, x);
+        model_.setState(x);
+        model_.tally();
+      }
+    }
+  };
+
+} // namespace cppbugs
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <new>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+namespace cppbugs {
+
+  // monotonic arena: objects are bump allocated out of large blocks
+  // and are only released all at once when the arena is destroyed
+  class MCArena {
+  private:
+    struct Destructor {
+      void (*destroy)(void*);
+      void* object;
+      Destructor* next;
+    };
+
+    std::vector<char*> blocks_;
+    char* cursor_;
+    size_t remaining_;
+    const size_t block_size_;
+    Destructor* destructors_;
+
+    template<typename T>
+    static void destroy(void* p) { static_cast<T*>(p)->~T(); }
+
+    static size_t padding(const char* p, const size_t align) {
+      return (align - reinterpret_cast<uintptr_t>(p) % align) % align;
+    }
+
+    void* allocate(const size_t size, const size_t align) {
+      size_t pad = padding(cursor_, align);
+      if(cursor_ == NULL || pad + size > remaining_) {
+        // oversized objects get a block of their own
+        const size_t n = std::max(block_size_, size + align);
+        cursor_ = static_cast<char*>(::operator new(n));
+        blocks_.push_back(cursor_);
+        remaining_ = n;
+        pad = padding(cursor_, align);
+      }
+      void* ans = cursor_ + pad;
+      cursor_ += pad + size;
+      remaining_ -= pad + size;
+      return ans;
+    }
+
+  public:
+    MCArena(const size_t block_size = 16384): cursor_(NULL), remaining_(0), block_size_(block_size), destructors_(NULL) {}
+    MCArena(const MCArena&) = delete;
+    MCArena& operator=(const MCArena&) = delete;
+
+    ~MCArena() {
+      // destructors run in reverse order of creation
+      for(Destructor* d = destructors_; d != NULL; d = d->next) {
+        d->destroy(d->object);
+      }
+      for(auto b : blocks_) {
+        ::operator delete(b);
+      }
+    }
+
+    template<typename T, typename... Args>
+    T* create(Args&&... args) {
+      if(std::is_trivially_destructible<T>::value) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+      }
+      // record is reserved first, but only linked once the ctor has succeeded
+      Destructor* d = static_cast<Destructor*>(allocate(sizeof(Destructor), alignof(Destructor)));
+      T* ans = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+      d->destroy = &destroy<T>;
+      d->object = ans;
+      d->next = destructors_;
+      destructors_ = d;
+      return ans;
+    }
+  };
+
+} // namespace cppbugs
@@ -50,7 +50,15 @@ namespace arma {
 
   // factln
   double factln(const int i) {
-    static std::vector<double> factln_table;
+    // filled once: initialising a static local is thread safe, growing the
+    // table on demand from several sampler threads was not
+    static const std::vector<double> factln_table = []() {
+      std::vector<double> ans;
+      for(int j = 0; j <= 100; j++) {
+        ans.push_back(std::log(boost::math::factorial<double>(static_cast<unsigned>(j))));
+      }
+      return ans;
+    }();
 
     if(i < 0) {
       return -std::numeric_limits<double>::infinity();
@@ -60,12 +68,6 @@ namespace arma {
       return boost::math::lgamma(static_cast<double>(i) + 1);
     }
 
-    if(factln_table.size() < static_cast<size_t>(i+1)) {
-      for(int j = factln_table.size(); j < (i+1); j++) {
-        factln_table.push_back(std::log(boost::math::factorial<double>(static_cast<double>(j))));
-      }
-    }
-    //for(auto v : factln_table) { std::cout << v << "|"; }  std::cout << std::endl;
     return factln_table[i];
   }
 
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/mcmc.summary.stats.hpp>
+
+namespace cppbugs {
+
+  // batch means of a vector valued stream, in at most max_batches batches:
+  // when full, adjacent batches are merged and the batch size doubles,
+  // so memory stays constant however long the chain runs
+  class BatchMeans {
+  private:
+    size_t max_batches_, batch_size_, count_;
+    double n_;
+    arma::vec sum_, mean_, m2_;
+    std::vector<arma::vec> batches_;
+
+    void merge_batches() {
+      const size_t n = batches_.size() / 2;
+      for(size_t i = 0; i < n; i++) {
+        batches_[i] = (batches_[2 * i] + batches_[2 * i + 1]) / 2;
+      }
+      batches_.erase(batches_.begin() + n, batches_.end());
+      batch_size_ *= 2;
+    }
+  public:
+    BatchMeans(const size_t batch_size = 1, const size_t max_batches = 64): max_batches_(max_batches), batch_size_(batch_size), count_(0), n_(0) {
+      if(batch_size_ < 1 || max_batches_ < 4 || max_batches_ % 2) {
+        throw std::logic_error("ERROR: BatchMeans needs batch_size >= 1 and an even max_batches >= 4.");
+      }
+      batches_.reserve(max_batches_);
+    }
+
+    void push_back(const arma::vec& x) {
+      if(n_ == 0) {
+        mean_.zeros(x.n_elem);
+        m2_.zeros(x.n_elem);
+      } else if(x.n_elem != mean_.n_elem) {
+        throw std::logic_error("ERROR: BatchMeans input changed size.");
+      }
+      n_ += 1;
+      for(size_t i = 0; i < x.n_elem; i++) {
+        const double delta = x[i] - mean_[i];
+        mean_[i] += delta / n_;
+        m2_[i] += delta * (x[i] - mean_[i]);
+      }
+      if(count_ == 0) {
+        sum_ = x;
+      } else {
+        sum_ += x;
+      }
+      if(++count_ == batch_size_) {
+        if(batches_.size() == max_batches_) { merge_batches(); }
+        // a merge doubles the batch size, so the current batch may not be done yet
+        if(count_ == batch_size_) {
+          batches_.push_back(sum_ / static_cast<double>(batch_size_));
+          count_ = 0;
+        }
+      }
+    }
+
+    size_t size() const { return static_cast<size_t>(n_); }
+    size_t batch_size() const { return batch_size_; }
+    size_t batches() const { return batches_.size(); }
+
+    // split R-hat per element over the latter half of the completed batches,
+    // cut into (chains) consecutive segments; NaN until there are 2 batches per segment
+    arma::vec rhat(const size_t chains = 4) const {
+      const size_t first = batches_.size() / 2;
+      const size_t m = (batches_.size() - first) / chains;
+      arma::vec ans(sum_.n_elem);
+      if(m < 2) {
+        ans.fill(arma::datum::nan);
+        return ans;
+      }
+      arma::mat x(m, chains);
+      for(size_t e = 0; e < ans.n_elem; e++) {
+        for(size_t j = 0; j < chains; j++) {
+          for(size_t i = 0; i < m; i++) {
+            x(i, j) = batches_[first + j * m + i][e];
+          }
+        }
+        ans[e] = detail::rhat(x);
+      }
+      return ans;
+    }
+
+    // effective sample size per element: batches * var(x) / var(batch means)
+    // NaN until half of max_batches are done, as few batches underestimate var(batch means)
+    arma::vec ess() const {
+      const size_t k = batches_.size();
+      arma::vec ans(mean_.n_elem);
+      if(k < max_batches_ / 2) {
+        ans.fill(arma::datum::nan);
+        return ans;
+      }
+      for(size_t e = 0; e < ans.n_elem; e++) {
+        double m(0), ss(0);
+        for(size_t i = 0; i < k; i++) { m += batches_[i][e]; }
+        m /= k;
+        for(size_t i = 0; i < k; i++) { ss += square(batches_[i][e] - m); }
+        const double var_batch = ss / (k - 1);
+        const double var_x = m2_[e] / (n_ - 1);
+        ans[e] = var_batch > 0 ? k * var_x / var_batch : k * batch_size_;
+      }
+      return ans;
+    }
+  };
+
+} // namespace cppbugs
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <string>
+#include <sstream>
 #include <boost/random.hpp>
 #include <cppbugs/mcmc.rng.base.hpp>
 
@@ -34,8 +36,26 @@ namespace cppbugs {
                       normal_rng_dist_(0, 1), uniform_rng_dist_(0, 1),
                       normal_rng_(generator_, normal_rng_dist_),
                       uniform_rng_(generator_, uniform_rng_dist_) {}
+    // independent streams, i.e. one per replica or thread
+    BoostRng(const typename T::result_type seed): RngBase(), generator_(seed),
+                      normal_rng_dist_(0, 1), uniform_rng_dist_(0, 1),
+                      normal_rng_(generator_, normal_rng_dist_),
+                      uniform_rng_(generator_, uniform_rng_dist_) {}
     double normal() { return normal_rng_(); }
     double uniform() { return uniform_rng_(); }
+
+    // the distributions are included, as they may cache a variate
+    std::string save() const {
+      std::ostringstream out;
+      out.precision(17);
+      out << generator_ << ' ' << normal_rng_.distribution() << ' ' << uniform_rng_.distribution();
+      return out.str();
+    }
+    void load(const std::string& state) {
+      std::istringstream in(state);
+      in >> generator_ >> normal_rng_.distribution() >> uniform_rng_.distribution();
+      if(!in) { throw std::runtime_error("ERROR: bad rng state."); }
+    }
   };
 
 } // namespace cppbugs
@@ -29,7 +29,16 @@ namespace cppbugs {
     void accept() { throw std::logic_error("Cannot accept a deterministic."); }
     void reject(){ throw std::logic_error("Cannot reject a deterministic."); }
     void tune() { throw std::logic_error("Cannot tune a deterministic."); }
-    // in Dynamic: void preserve()
+    void finishTuning() { throw std::logic_error("Cannot tune a deterministic."); }
+    // deterministic jumps assign value wholesale, so the current buffer is
+    // swapped out up front (copied only if the shapes differ, i.e. the first time)
+    void preserve() {
+      if(dim_size(Dynamic<T>::old_value) != dim_size(Dynamic<T>::value)) {
+        Dynamic<T>::old_value = Dynamic<T>::value;
+      }
+      Dynamic<T>::preserve();
+      Dynamic<T>::commit();
+    }
     // in Dynamic: void revert()
     // in Dynamic: void tally()
     bool isDeterministc() const { return true; }
@@ -0,0 +1,198 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <armadillo>
+#include <cppbugs/mcmc.arena.hpp>
+#include <cppbugs/mcmc.model.hpp>
+#include <cppbugs/mcmc.thread.pool.hpp>
+
+namespace cppbugs {
+
+  // differential evolution mcmc with a history of past states, DE-MC(z)
+  // (ter Braak & Vrugt 2008).  a chain proposes
+  //   x* = x + gamma (z_r1 - z_r2) + e,  gamma = 2.38 / sqrt(2 d),  e ~ N(0, noise^2)
+  // where z_r1, z_r2 are two past states of any chain.  the difference vectors
+  // follow the shape and scale of the posterior, which isotropic per-node jumps
+  // don't, and need no tuning.  every 10th generation gamma = 1, to allow jumps
+  // between modes
+  //
+  // the history is one column major matrix, appended to every history_thin
+  // generations and only read while chains move.  chains are spread over
+  // threads, each thread evaluating logp on its own copy of the model (see
+  // EnsembleSampler); all draws are made on the calling thread, so results do
+  // not depend on the thread count
+  //
+  //   DifferentialEvolution<BoostRng<boost::mt19937> > de([&](MCModel& m, const size_t t) {
+  //     ...
+  //     if(t == 0) { b_hist = &m.track<std::vector>(b); }
+  //   }, 4, 4);
+  //   de.burn(1e4); de.sample(1e5, 10);
+  template<typename RNG>
+  class DifferentialEvolution {
+  public:
+    typedef std::function<void (MCModel&, const size_t)> Builder;
+  private:
+    MCArena arena_;
+    std::vector<RNG*> rngs_;
+    std::vector<MCModel*> models_;
+    ThreadPool pool_;
+    const int history_thin_;
+    const double noise_;
+    arma::mat chains_, proposals_, history_;
+    size_t history_size_;
+    arma::vec logp_, proposal_logp_;
+    uint64_t generation_;
+    double accepted_, rejected_;
+
+    void append_history(const arma::vec& x) {
+      if(history_size_ == history_.n_cols) {
+        arma::mat bigger(history_.n_rows, std::max<size_t>(2 * history_.n_cols, 16));
+        std::copy(history_.memptr(), history_.memptr() + history_.n_elem, bigger.memptr());
+        history_.swap(bigger);
+      }
+      std::copy(x.memptr(), x.memptr() + x.n_elem, history_.colptr(history_size_));
+      ++history_size_;
+    }
+
+    size_t draw_index(RngBase& rng, const size_t n) {
+      return std::min(static_cast<size_t>(rng.uniform() * n), n - 1);
+    }
+
+    void tally() {
+      MCModel& m = *models_[0];
+      for(size_t c = 0; c < chains_.n_cols; c++) {
+        m.setState(chains_.col(c));
+        m.tally();
+      }
+    }
+  public:
+    // the history starts with max(10 d, chains) states of model 0's metropolis
+    // chain, spaced init_spacing steps apart; chains start from the last of them
+    DifferentialEvolution(Builder build, const size_t chains = 3, const size_t threads = 1, const int history_thin = 10, const double noise = 1e-4, const int init_spacing = 10, const unsigned int seed = 5489):
+      pool_(std::max<size_t>(threads, 1)), history_thin_(history_thin), noise_(noise), history_size_(0), generation_(0), accepted_(0), rejected_(0) {
+      if(chains < 1 || history_thin < 1) {
+        throw std::logic_error("ERROR: differential evolution needs at least 1 chain and history_thin >= 1.");
+      }
+      for(size_t t = 0; t < pool_.size(); t++) {
+        rngs_.push_back(arena_.create<RNG>(seed + t));
+        models_.push_back(arena_.create<MCModel>(*rngs_[t]));
+        build(*models_[t], t);
+        if(!models_[t]->state_complete()) {
+          throw std::logic_error("ERROR: differential evolution moves the flat state, so every parameter must be packable (no integer, Wishart or MVCAR nodes).");
+        }
+      }
+      MCModel& m = *models_[0];
+      const size_t d = m.state_size();
+      for(auto p : models_) {
+        if(p->state_size() != d) { throw std::logic_error("ERROR: differential evolution models differ in state size."); }
+      }
+      history_.set_size(d, std::max<size_t>(10 * d, chains));
+      arma::vec x;
+      for(size_t i = 0; i < history_.n_cols; i++) {
+        for(int s = 0; s < init_spacing; s++) { m.step(); }
+        m.getState(x);
+        append_history(x);
+      }
+      m.resetAcceptanceRatio();
+      chains_.set_size(d, chains);
+      logp_.set_size(chains);
+      for(size_t c = 0; c < chains; c++) {
+        chains_.col(c) = history_.col(history_size_ - chains + c);
+        logp_[c] = m.logp_at(chains_.col(c));
+      }
+      proposals_.set_size(d, chains);
+      proposal_logp_.set_size(chains);
+    }
+
+    size_t size() const { return chains_.n_cols; }
+    MCModel& model(const size_t t) { return *models_.at(t); }
+    const arma::mat& chains() const { return chains_; }
+    const arma::vec& chain_logp() const { return logp_; }
+    size_t history_size() const { return history_size_; }
+
+    double acceptance_ratio() const {
+      return accepted_ / (accepted_ + rejected_);
+    }
+
+    void resetAcceptanceRatio() {
+      accepted_ = 0;
+      rejected_ = 0;
+    }
+
+    // one generation moves every chain once
+    void step() {
+      RngBase& rng = *rngs_[0];
+      const size_t d = chains_.n_rows, n = chains_.n_cols;
+      ++generation_;
+      const double gamma = generation_ % 10 == 0 ? 1.0 : 2.38 / sqrt(2.0 * d);
+      for(size_t c = 0; c < n; c++) {
+        const size_t r1 = draw_index(rng, history_size_);
+        size_t r2 = draw_index(rng, history_size_ - 1);
+        if(r2 >= r1) { ++r2; }
+        const double* z1 = history_.colptr(r1);
+        const double* z2 = history_.colptr(r2);
+        const double* x = chains_.colptr(c);
+        double* y = proposals_.colptr(c);
+        for(size_t j = 0; j < d; j++) {
+          y[j] = x[j] + gamma * (z1[j] - z2[j]) + noise_ * rng.normal();
+        }
+      }
+      pool_.run([this, n](const size_t t) {
+          for(size_t c = t; c < n; c += models_.size()) {
+            proposal_logp_[c] = models_[t]->logp_at(proposals_.col(c));
+          }
+        });
+      for(size_t c = 0; c < n; c++) {
+        const double value = proposal_logp_[c];
+        if(!std::isnan(value) && value != -std::numeric_limits<double>::infinity() && log(rng.uniform()) < value - logp_[c]) {
+          chains_.col(c) = proposals_.col(c);
+          logp_[c] = value;
+          accepted_ += 1;
+        } else {
+          rejected_ += 1;
+        }
+      }
+      if(generation_ % history_thin_ == 0) {
+        arma::vec x;
+        for(size_t c = 0; c < n; c++) {
+          x = chains_.col(c);
+          append_history(x);
+        }
+      }
+    }
+
+    void burn(const int iterations) {
+      for(int i = 1; i <= iterations; i++) { step(); }
+    }
+
+    void sample(const int iterations, const int thin) {
+      for(int i = 1; i <= iterations; i++) {
+        step();
+        if(i % thin == 0) { tally(); }
+      }
+    }
+  };
+
+} // namespace cppbugs
@@ -22,24 +22,24 @@
 
 namespace cppbugs {
 
-template <class T,class U,class V> using Normal = Stochastic2p<T,U,V,normal_logp>;
-template <class T,class U,class V> using ObservedNormal = ObservedStochastic2p<T,U,V,normal_logp>;
+template <class T,class U,class V> using Normal = Stochastic2p<T,U,V,normal_logp,normal_logp_elements>;
+template <class T,class U,class V> using ObservedNormal = ObservedStochastic2p<T,U,V,normal_logp,normal_logp_elements>;
 
-template <class T,class U,class V> using Uniform = Stochastic2p<T,U,V,uniform_logp>;
-template <class T,class U,class V> using ObservedUniform = ObservedStochastic2p<T,U,V,uniform_logp>;
+template <class T,class U,class V> using Uniform = Stochastic2p<T,U,V,uniform_logp,uniform_logp_elements,uniform_support>;
+template <class T,class U,class V> using ObservedUniform = ObservedStochastic2p<T,U,V,uniform_logp,uniform_logp_elements>;
 
 // modified jumper to only take jumps on (0,1) interval
 // FIXME: void jump(RngBase& rng) { bounded_jump_impl(rng, DynamicStochastic<T>::value, DynamicStochastic<T>::scale_, 0, 1); }
-template <class T,class U,class V> using Beta = Stochastic2p<T,U,V,beta_logp>;
-template <class T,class U,class V> using ObservedBeta = ObservedStochastic2p<T,U,V,beta_logp>;
+template <class T,class U,class V> using Beta = Stochastic2p<T,U,V,beta_logp,beta_logp_elements,beta_support>;
+template <class T,class U,class V> using ObservedBeta = ObservedStochastic2p<T,U,V,beta_logp,beta_logp_elements>;
 
-template <class T,class U,class V> using Binomial = Stochastic2p<T,U,V,binomial_logp>;
-template <class T,class U,class V> using ObservedBinomial = ObservedStochastic2p<T,U,V,binomial_logp>;
+template <class T,class U,class V> using Binomial = Stochastic2p<T,U,V,binomial_logp,binomial_logp_elements>;
+template <class T,class U,class V> using ObservedBinomial = ObservedStochastic2p<T,U,V,binomial_logp,binomial_logp_elements>;
 
 // modified jumper to only take positive jumps
 // FIXME: void jump(RngBase& rng) { positive_jump_impl(rng, DynamicStochastic<T>::value, DynamicStochastic<T>::scale_); }
-template <class T,class U,class V> using Gamma = Stochastic2p<T,U,V,gamma_logp>;
-template <class T,class U,class V> using ObservedGamma = ObservedStochastic2p<T,U,V,gamma_logp>;
+template <class T,class U,class V> using Gamma = Stochastic2p<T,U,V,gamma_logp,gamma_logp_elements,gamma_support>;
+template <class T,class U,class V> using ObservedGamma = ObservedStochastic2p<T,U,V,gamma_logp,gamma_logp_elements>;
 
 // FIXME: dimension check will not work on this
 template <class T,class U,class V> using MultivariateNormal = Stochastic2p<T,U,V,multivariate_normal_sigma_logp>;
@@ -52,11 +52,11 @@ template <class T,class U,class V> using ObservedMultivariateNormalChol = Observ
 
 // modified jumper to only take positive jumps
 // FIXME: void jump(RngBase& rng) { positive_jump_impl(rng, DynamicStochastic<T>::value,DynamicStochastic<T>::scale_); }
-template <class T,class U> using Exponential = Stochastic1p<T,U,exponential_logp>;
-template <class T,class U> using ObservedExponential = ObservedStochastic1p<T,U,exponential_logp>;
+template <class T,class U> using Exponential = Stochastic1p<T,U,exponential_logp,exponential_logp_elements,exponential_support>;
+template <class T,class U> using ObservedExponential = ObservedStochastic1p<T,U,exponential_logp,exponential_logp_elements>;
 
-template <class T,class U> using Poisson = Stochastic1p<T,U,poisson_logp>;
-template <class T,class U> using ObservedPoisson = ObservedStochastic1p<T,U,poisson_logp>;
+template <class T,class U> using Poisson = Stochastic1p<T,U,poisson_logp,poisson_logp_elements>;
+template <class T,class U> using ObservedPoisson = ObservedStochastic1p<T,U,poisson_logp,poisson_logp_elements>;
 
 
 template <class T,class U> using Categorical = Stochastic1p<T,U,categorical_logp>;
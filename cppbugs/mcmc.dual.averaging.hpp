@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+
+namespace cppbugs {
+
+  // dual averaging (Nesterov 2009, as used for step sizes by Hoffman & Gelman 2014)
+  // of a log scale toward a target acceptance ratio; each update takes the
+  // acceptance ratio since the last one.  the averaged iterate is what is kept
+  // once tuning is done, since the raw iterate keeps moving w/ the noise
+  class DualAveraging {
+  private:
+    double mu_, h_bar_, x_, x_bar_;
+    int t_;
+  public:
+    DualAveraging(): mu_(0), h_bar_(0), x_(0), x_bar_(0), t_(0) {}
+
+    void restart(const double x0) {
+      mu_ = x0;
+      h_bar_ = 0;
+      x_ = x0;
+      x_bar_ = x0;
+      t_ = 0;
+    }
+    void stop() { t_ = 0; }
+    bool running() const { return t_ > 0; }
+
+    double update(const double acceptance_ratio, const double target_ar) {
+      const double gamma = 0.05, kappa = 0.75, t0 = 10;
+      ++t_;
+      const double w = 1.0 / (t_ + t0);
+      h_bar_ = (1 - w) * h_bar_ + w * (acceptance_ratio - target_ar);
+      x_ = mu_ + std::sqrt(static_cast<double>(t_)) / gamma * h_bar_;
+      const double eta = std::pow(static_cast<double>(t_), -kappa);
+      x_bar_ = eta * x_ + (1 - eta) * x_bar_;
+      return x_;
+    }
+
+    double value() const { return x_; }
+    double average() const { return x_bar_; }
+  };
+
+} // namespace cppbugs
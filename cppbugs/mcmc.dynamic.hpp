@@ -22,15 +22,37 @@
 
 namespace cppbugs {
 
+  // value and old_value form a double buffer: preserve() copies nothing,
+  // a jump writes its proposal into spare() and then commit()s, which swaps
+  // the buffers so old_value holds the pre-jump state.  revert() swaps back.
+  // nodes that are never touched between preserve and revert cost nothing.
   template<typename T>
   class Dynamic : public MCMCSpecialized<T> {
+  protected:
+    // true when old_value holds the state saved by the last preserve
+    bool saved_;
   public:
     T& value;
     T old_value;
-    Dynamic(T& shape): MCMCSpecialized<T>(), value(shape), old_value(shape) {}
+    Dynamic(T& shape): MCMCSpecialized<T>(), saved_(false), value(shape), old_value(shape) {}
 
-    void preserve() { old_value = value; }
-    void revert() { value = old_value; }
+    void preserve() { saved_ = false; }
+    void revert() {
+      if(saved_) {
+        swap_values(value, old_value);
+        saved_ = false;
+      }
+    }
+
+    // buffer to write the next state into; once the current state has
+    // already been saved, the update happens in place
+    T& spare() { return saved_ ? value : old_value; }
+    void commit() {
+      if(!saved_) {
+        swap_values(value, old_value);
+        saved_ = true;
+      }
+    }
     double size() const { return dim_size(value); }
   };
 
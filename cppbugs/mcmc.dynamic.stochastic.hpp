@@ -22,16 +22,55 @@
 #include <cppbugs/mcmc.stochastic.hpp>
 #include <cppbugs/mcmc.jump.hpp>
 #include <cppbugs/mcmc.math.hpp>
+#include <cppbugs/mcmc.packable.hpp>
+#include <cppbugs/mcmc.dual.averaging.hpp>
+#include <cppbugs/mcmc.serialize.hpp>
 
 namespace cppbugs {
 
   template<typename T>
-  class DynamicStochastic : public Dynamic<T>, public Stochastic  {
+  class DynamicStochastic : public Dynamic<T>, public Stochastic, public Packable  {
   protected:
     bool observed_;
     double accepted_,rejected_,scale_,target_ar_;
+    DualAveraging adapt_;
+    // relative per element scales (a diagonal preconditioner), empty until
+    // learned from the variance of the value while tuning
+    arma::vec element_scale_, tune_mean_, tune_m2_;
+    double tune_n_, tune_window_;
+
+    void observe() {
+      const size_t k = dim_size(Dynamic<T>::value);
+      if(tune_n_ == 0) {
+        tune_mean_.zeros(k);
+        tune_m2_.zeros(k);
+      }
+      tune_n_ += 1;
+      for(size_t i = 0; i < k; i++) {
+        const double x_i = element(Dynamic<T>::value, i);
+        const double delta = x_i - tune_mean_[i];
+        tune_mean_[i] += delta / tune_n_;
+        tune_m2_[i] += delta * (x_i - tune_mean_[i]);
+      }
+    }
+
+    // sd of each element relative to their rms, so that scale_ keeps its meaning
+    // estimated over doubling windows, so early (still converging) draws are forgotten
+    void update_element_scales() {
+      const double floor = 1e-3;
+      if(tune_n_ < tune_window_ || tune_m2_.n_elem < 2) { return; }
+      const arma::vec sd = arma::sqrt(tune_m2_ / (tune_n_ - 1));
+      tune_n_ = 0;
+      tune_window_ *= 2;
+      const double rms = std::sqrt(arma::accu(arma::square(sd)) / sd.n_elem);
+      if(!(rms > 0)) { return; }
+      element_scale_.set_size(sd.n_elem);
+      for(size_t i = 0; i < sd.n_elem; i++) {
+        element_scale_[i] = std::max(sd[i] / rms, floor);
+      }
+    }
   public:
-    DynamicStochastic(T& value): Dynamic<T>(value), accepted_(0), rejected_(0) {
+    DynamicStochastic(T& value): Dynamic<T>(value), accepted_(0), rejected_(0), tune_n_(0), tune_window_(25) {
       const double scale_num = 2.38;
       double ideal_scale = sqrt(scale_num / pow(dim_size(Dynamic<T>::value),2));
       scale_ = ideal_scale > 1.0 ? 1.0 : ideal_scale;
@@ -42,21 +81,37 @@ namespace cppbugs {
       target_ar_ = std::max(1/log2(dim_size(Dynamic<T>::value) + 3),0.234);
     }
     virtual ~DynamicStochastic() {}
-    void jump(RngBase& rng) { jump_impl(rng,Dynamic<T>::value,scale_); }
+    void jump(RngBase& rng) {
+      // the pre-jump value is the current state of the chain
+      if(adapt_.running()) { observe(); }
+      if(element_scale_.n_elem) {
+        jump_impl(rng,Dynamic<T>::spare(),Dynamic<T>::value,scale_,element_scale_);
+      } else {
+        jump_impl(rng,Dynamic<T>::spare(),Dynamic<T>::value,scale_);
+      }
+      Dynamic<T>::commit();
+    }
     void accept() { accepted_ += 1; }
     void reject() { rejected_ += 1; }
+    // dual averaging on log(scale_), restarted from the current scale
+    // on the first call after finishTuning (or ever)
     void tune() {
-      const double thresh = 0.1;
-      const double dilution = 1.0;
-
+      if(accepted_ + rejected_ == 0) { return; }
       double acceptance_ratio = accepted_ / (accepted_ + rejected_);
       accepted_ = 0;
       rejected_ = 0;
 
-      double diff = acceptance_ratio - target_ar_;
-      if(std::abs(diff) > thresh) {
-        scale_ *= (1.0 + diff * dilution);
+      if(!adapt_.running()) { adapt_.restart(log(scale_)); }
+      scale_ = exp(adapt_.update(acceptance_ratio, target_ar_));
+      update_element_scales();
+    }
+    void finishTuning() {
+      if(adapt_.running()) {
+        scale_ = exp(adapt_.average());
+        adapt_.stop();
       }
+      tune_n_ = 0;
+      tune_window_ = 25;
     }
     // in Dynamic: void preserve()
     // in Dynamic: void revert()
@@ -64,8 +119,35 @@ namespace cppbugs {
     bool isDeterministc() const { return false; }
     bool isStochastic() const { return true; }
     bool isObserved() const { return false; }
+    size_t packed_size() const { return flat_size(Dynamic<T>::value); }
+    void bind(double* mem, const bool copy) { flat_bind(Dynamic<T>::value, mem, copy); }
+    void install(double* mem) {
+      flat_bind(Dynamic<T>::spare(), mem, false);
+      Dynamic<T>::commit();
+    }
+    void propose(RngBase& rng, double* out, const double* in) const {
+      const size_t n = packed_size();
+      if(element_scale_.n_elem) {
+        for(size_t i = 0; i < n; i++) {
+          out[i] = in[i] + rng.normal() * scale_ * element_scale_[i];
+        }
+      } else {
+        for(size_t i = 0; i < n; i++) {
+          out[i] = in[i] + rng.normal() * scale_;
+        }
+      }
+    }
     void setScale(const double scale) { scale_ = scale; }
     double getScale() const { return scale_; }
+    arma::vec getElementScales() const { return element_scale_; }
+    void setElementScales(const arma::vec& element_scale) {
+      if(element_scale.n_elem && element_scale.n_elem != dim_size(Dynamic<T>::value)) {
+        throw std::logic_error("ERROR: element scales do not match the size of the node.");
+      }
+      element_scale_ = element_scale;
+    }
+    void save_value(BinaryWriter& out) const { out.put_value(Dynamic<T>::value); }
+    void load_value(BinaryReader& in) { in.get_value(Dynamic<T>::value); }
   };
 
 } // namespace cppbugs
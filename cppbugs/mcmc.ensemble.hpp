@@ -0,0 +1,185 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <armadillo>
+#include <cppbugs/mcmc.arena.hpp>
+#include <cppbugs/mcmc.model.hpp>
+#include <cppbugs/mcmc.thread.pool.hpp>
+
+namespace cppbugs {
+
+  // affine invariant ensemble sampler (Goodman & Weare 2010, the emcee
+  // stretch move) over the flat model state.  W walkers are split in two
+  // halves; each half moves using the other as its reference, so the logp
+  // evaluations within a half are independent and are spread over threads.
+  // every thread owns a copy of the model built by the same function and
+  // only uses it to evaluate logp at a walker's state, so deterministic
+  // nodes need no changes
+  //
+  //   EnsembleSampler<BoostRng<boost::mt19937> > es([&](MCModel& m, const size_t t) {
+  //     vec& b = m.make<vec>(randn<vec>(2));
+  //     m.link<Normal>(b, 0, 0.001);
+  //     ...
+  //     if(t == 0) { b_hist = &m.track<std::vector>(b); }
+  //   }, 64, 4);
+  //   es.burn(2e3); es.sample(1e4, 10);
+  //
+  // each tally records every walker, through model 0
+  template<typename RNG>
+  class EnsembleSampler {
+  public:
+    typedef std::function<void (MCModel&, const size_t)> Builder;
+  private:
+    MCArena arena_;
+    std::vector<RNG*> rngs_;
+    std::vector<MCModel*> models_;
+    ThreadPool pool_;
+    const double a_;
+    arma::mat walkers_, proposals_;
+    arma::vec logp_, proposal_logp_, z_;
+    std::vector<size_t> partners_;
+    double accepted_, rejected_;
+
+    // stretch the walkers of one half toward/away from random walkers of the other
+    void move(const size_t half) {
+      const size_t n = walkers_.n_cols / 2;
+      const size_t first = half * n, other = (1 - half) * n;
+      RngBase& rng = *rngs_[0];
+      // all draws are made here, so results do not depend on the thread count
+      for(size_t i = 0; i < n; i++) {
+        const double u = rng.uniform();
+        z_[i] = pow((a_ - 1) * u + 1, 2) / a_;
+        partners_[i] = other + std::min(static_cast<size_t>(rng.uniform() * n), n - 1);
+        proposals_.col(i) = walkers_.col(partners_[i]) + z_[i] * (walkers_.col(first + i) - walkers_.col(partners_[i]));
+      }
+      pool_.run([this, n](const size_t t) {
+          for(size_t i = t; i < n; i += models_.size()) {
+            proposal_logp_[i] = models_[t]->logp_at(proposals_.col(i));
+          }
+        });
+      const double d = walkers_.n_rows;
+      for(size_t i = 0; i < n; i++) {
+        const double log_ratio = (d - 1) * log(z_[i]) + proposal_logp_[i] - logp_[first + i];
+        if(!std::isnan(proposal_logp_[i]) && proposal_logp_[i] != -std::numeric_limits<double>::infinity() && log(rng.uniform()) < log_ratio) {
+          walkers_.col(first + i) = proposals_.col(i);
+          logp_[first + i] = proposal_logp_[i];
+          accepted_ += 1;
+        } else {
+          rejected_ += 1;
+        }
+      }
+    }
+
+    void tally() {
+      MCModel& m = *models_[0];
+      for(size_t w = 0; w < walkers_.n_cols; w++) {
+        m.setState(walkers_.col(w));
+        m.tally();
+      }
+    }
+  public:
+    // walkers start from model 0's own metropolis chain, tuned for init_tuning
+    // steps and then read every init_spacing steps, so every walker starts
+    // inside the support and the walkers are spread like the posterior.  the
+    // stretch move can't leave the span of the walkers, so they must span the
+    // whole state: this needs more walkers than parameters and a chain that
+    // moves every parameter
+    EnsembleSampler(Builder build, const size_t walkers, const size_t threads = 1, const double a = 2.0, const int init_spacing = 10, const int init_tuning = 4000, const unsigned int seed = 5489):
+      pool_(std::max<size_t>(threads, 1)), a_(a), accepted_(0), rejected_(0) {
+      if(walkers < 4 || walkers % 2 || a <= 1 || init_spacing < 1) {
+        throw std::logic_error("ERROR: ensemble needs an even number of walkers (>= 4), a > 1 and init_spacing >= 1.");
+      }
+      for(size_t t = 0; t < pool_.size(); t++) {
+        rngs_.push_back(arena_.create<RNG>(seed + t));
+        models_.push_back(arena_.create<MCModel>(*rngs_[t]));
+        build(*models_[t], t);
+        if(!models_[t]->state_complete()) {
+          throw std::logic_error("ERROR: the ensemble moves the flat state, so every parameter must be packable (no integer, Wishart or MVCAR nodes).");
+        }
+      }
+      MCModel& m = *models_[0];
+      const size_t d = m.state_size();
+      for(auto p : models_) {
+        if(p->state_size() != d) { throw std::logic_error("ERROR: ensemble models differ in state size."); }
+      }
+      if(walkers <= d) {
+        throw std::logic_error("ERROR: ensemble needs more walkers than parameters.");
+      }
+      if(init_tuning > 0) { m.tune(init_tuning, 100); }
+      walkers_.set_size(d, walkers);
+      logp_.set_size(walkers);
+      arma::vec x;
+      for(size_t w = 0; w < walkers; w++) {
+        for(int s = 0; s < init_spacing; s++) { m.step(); }
+        m.getState(x);
+        walkers_.col(w) = x;
+        logp_[w] = m.logp_at(x);
+      }
+      m.resetAcceptanceRatio();
+      const arma::vec centre = arma::mean(walkers_, 1);
+      arma::mat centred(d, walkers);
+      for(size_t w = 0; w < walkers; w++) { centred.col(w) = walkers_.col(w) - centre; }
+      if(arma::rank(centred) < d) {
+        throw std::logic_error("ERROR: ensemble walkers don't span the state, some parameters never moved during init (increase init_spacing or init_tuning).");
+      }
+      proposals_.set_size(d, walkers / 2);
+      proposal_logp_.set_size(walkers / 2);
+      z_.set_size(walkers / 2);
+      partners_.resize(walkers / 2);
+    }
+
+    size_t size() const { return walkers_.n_cols; }
+    MCModel& model(const size_t t) { return *models_.at(t); }
+    const arma::mat& walkers() const { return walkers_; }
+    const arma::vec& walker_logp() const { return logp_; }
+
+    double acceptance_ratio() const {
+      return accepted_ / (accepted_ + rejected_);
+    }
+
+    void resetAcceptanceRatio() {
+      accepted_ = 0;
+      rejected_ = 0;
+    }
+
+    // one iteration moves every walker once
+    void step() {
+      move(0);
+      move(1);
+    }
+
+    void burn(const int iterations) {
+      for(int i = 1; i <= iterations; i++) { step(); }
+    }
+
+    void sample(const int iterations, const int thin) {
+      for(int i = 1; i <= iterations; i++) {
+        step();
+        if(i % thin == 0) { tally(); }
+      }
+    }
+  };
+
+} // namespace cppbugs
@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>. //
 ///////////////////////////////////////////////////////////////////////////
 
+#include <armadillo>
 #include <cppbugs/mcmc.rng.base.hpp>
 
 #pragma once
@@ -37,4 +38,42 @@ namespace cppbugs {
     }
   }
 
+  // out = in + noise, out may alias in
+  void jump_impl(RngBase& rng, int& out, const int& in, const double scale) {
+    out = in + lrint(rng.normal() * scale);
+  }
+
+  void jump_impl(RngBase& rng, double& out, const double& in, const double scale) {
+    out = in + rng.normal() * scale;
+  }
+
+  template<typename T>
+  void jump_impl(RngBase& rng, T& out, const T& in, const double scale) {
+    if(out.n_elem != in.n_elem) {
+      out.copy_size(in);
+    }
+    for(size_t i = 0; i < in.n_elem; i++) {
+      jump_impl(rng, out[i], in[i], scale);
+    }
+  }
+
+  // w/ a relative scale per element (diagonal preconditioning)
+  void jump_impl(RngBase& rng, int& out, const int& in, const double scale, const arma::vec& element_scale) {
+    jump_impl(rng, out, in, scale * element_scale[0]);
+  }
+
+  void jump_impl(RngBase& rng, double& out, const double& in, const double scale, const arma::vec& element_scale) {
+    jump_impl(rng, out, in, scale * element_scale[0]);
+  }
+
+  template<typename T>
+  void jump_impl(RngBase& rng, T& out, const T& in, const double scale, const arma::vec& element_scale) {
+    if(out.n_elem != in.n_elem) {
+      out.copy_size(in);
+    }
+    for(size_t i = 0; i < in.n_elem; i++) {
+      jump_impl(rng, out[i], in[i], scale * element_scale[i]);
+    }
+  }
+
 } // namespace cppbugs
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <stdexcept>
+#include <algorithm>
 #include <armadillo>
 #include <cppbugs/mcmc.icsi.log.hpp>
 #include <cppbugs/mcmc.arma.extensions.hpp>
@@ -202,4 +203,143 @@ namespace cppbugs {
     return 0;
   }
 
+  // elementwise log densities: add the contribution of element i into ans[i]
+  // (for i < ans.n_elem) so that independent components can be accepted separately
+  // scalar parameters are broadcast
+  static inline double element(const double x, const size_t i) {
+    return x;
+  }
+
+  static inline double element(const int x, const size_t i) {
+    return x;
+  }
+
+  // indexable types are read directly; anything else (i.e. arma::subview_elem2
+  // hyperparameters) still compiles, but has no elementwise density
+  template<typename T>
+  auto element_impl(const T& x, const size_t i, int) -> decltype(static_cast<double>(x[i])) {
+    return x[i];
+  }
+
+  template<typename T>
+  double element_impl(const T& x, const size_t i, long) {
+    throw std::logic_error("ERROR: no elementwise density: a parameter of this node can't be indexed.");
+  }
+
+  template<typename T>
+  double element(const T& x, const size_t i) {
+    return element_impl(x, i, 0);
+  }
+
+  template<typename T, typename U, typename V>
+  void no_logp_elements(arma::vec& ans, const T& x, const U& p1, const V& p2) {
+    throw std::logic_error("ERROR: this distribution has no elementwise log density.");
+  }
+
+  template<typename T, typename U>
+  void no_logp_elements(arma::vec& ans, const T& x, const U& p1) {
+    throw std::logic_error("ERROR: this distribution has no elementwise log density.");
+  }
+
+  template<typename T, typename U, typename V>
+  void normal_logp_elements(arma::vec& ans, const T& x, const U& mu, const V& tau) {
+    for(size_t i = 0; i < ans.n_elem; i++) {
+      const double tau_i = element(tau,i);
+      ans[i] += 0.5*log_approx(0.5*tau_i/arma::datum::pi) - 0.5 * tau_i * square(element(x,i) - element(mu,i));
+    }
+  }
+
+  template<typename T, typename U, typename V>
+  void uniform_logp_elements(arma::vec& ans, const T& x, const U& lower, const V& upper) {
+    for(size_t i = 0; i < ans.n_elem; i++) {
+      const double x_i = element(x,i), lower_i = element(lower,i), upper_i = element(upper,i);
+      ans[i] += (x_i < lower_i || x_i > upper_i) ? -std::numeric_limits<double>::infinity() : -log_approx(upper_i - lower_i);
+    }
+  }
+
+  template<typename T, typename U, typename V>
+  void gamma_logp_elements(arma::vec& ans, const T& x, const U& alpha, const V& beta) {
+    for(size_t i = 0; i < ans.n_elem; i++) {
+      const double x_i = element(x,i), alpha_i = element(alpha,i), beta_i = element(beta,i);
+      ans[i] += x_i < 0 ?
+        -std::numeric_limits<double>::infinity() :
+        (alpha_i - 1.0)*log_approx(x_i) - beta_i*x_i - lgamma(alpha_i) + alpha_i*log_approx(beta_i);
+    }
+  }
+
+  template<typename T, typename U, typename V>
+  void beta_logp_elements(arma::vec& ans, const T& x, const U& alpha, const V& beta) {
+    for(size_t i = 0; i < ans.n_elem; i++) {
+      const double x_i = element(x,i), alpha_i = element(alpha,i), beta_i = element(beta,i);
+      ans[i] += x_i <= 0 || x_i >= 1 || alpha_i <= 0 || beta_i <= 0 ?
+        -std::numeric_limits<double>::infinity() :
+        lgamma(alpha_i+beta_i) - lgamma(alpha_i) - lgamma(beta_i) + (alpha_i-1.0)*log_approx(x_i) + (beta_i-1.0)*log_approx(1.0-x_i);
+    }
+  }
+
+  template<typename T, typename U, typename V>
+  void binomial_logp_elements(arma::vec& ans, const T& x, const U& n, const V& p) {
+    for(size_t i = 0; i < ans.n_elem; i++) {
+      const int x_i = element(x,i), n_i = element(n,i);
+      const double p_i = element(p,i);
+      ans[i] += p_i <= 0 || p_i >= 1 || x_i < 0 || x_i > n_i ?
+        -std::numeric_limits<double>::infinity() :
+        x_i*log_approx(p_i) + (n_i-x_i)*log_approx(1-p_i) + arma::factln(n_i) - arma::factln(x_i) - arma::factln(n_i-x_i);
+    }
+  }
+
+  template<typename T, typename U>
+  void poisson_logp_elements(arma::vec& ans, const T& x, const U& mu) {
+    for(size_t i = 0; i < ans.n_elem; i++) {
+      const int x_i = element(x,i);
+      const double mu_i = element(mu,i);
+      ans[i] += mu_i < 0 || x_i < 0 ?
+        -std::numeric_limits<double>::infinity() :
+        x_i*log_approx(mu_i) - mu_i - arma::factln(x_i);
+    }
+  }
+
+  template<typename T, typename U>
+  void exponential_logp_elements(arma::vec& ans, const T& x, const U& lambda) {
+    for(size_t i = 0; i < ans.n_elem; i++) {
+      const double x_i = element(x,i), lambda_i = element(lambda,i);
+      ans[i] += x_i <= 0 || lambda_i <= 0 ?
+        -std::numeric_limits<double>::infinity() :
+        log_approx(lambda_i) - lambda_i*x_i;
+    }
+  }
+
+  // support of each of the n elements of a node, for transforms to an
+  // unconstrained space: bounds are only written where they are finite
+  // (lower and upper come in as -inf and inf)
+  template<typename U, typename V>
+  void unbounded_support(double* lower, double* upper, const size_t n, const U& p1, const V& p2) {}
+
+  template<typename U>
+  void unbounded_support(double* lower, double* upper, const size_t n, const U& p1) {}
+
+  template<typename U, typename V>
+  void uniform_support(double* lower, double* upper, const size_t n, const U& lo, const V& hi) {
+    for(size_t i = 0; i < n; i++) {
+      lower[i] = element(lo,i);
+      upper[i] = element(hi,i);
+    }
+  }
+
+  template<typename U, typename V>
+  void gamma_support(double* lower, double* upper, const size_t n, const U& alpha, const V& beta) {
+    std::fill(lower, lower + n, 0.0);
+  }
+
+  template<typename U, typename V>
+  void beta_support(double* lower, double* upper, const size_t n, const U& alpha, const V& beta) {
+    std::fill(lower, lower + n, 0.0);
+    std::fill(upper, upper + n, 1.0);
+  }
+
+  template<typename U>
+  void exponential_support(double* lower, double* upper, const size_t n, const U& lambda) {
+    std::fill(lower, lower + n, 0.0);
+  }
+
 } // namespace cppbugs
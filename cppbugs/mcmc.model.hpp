@@ -20,16 +20,28 @@
 #include <cmath>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <map>
+#include <string>
+#include <cstring>
+#include <typeinfo>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <exception>
+#include <armadillo>
 #include <boost/random.hpp>
 #include <cppbugs/mcmc.rng.base.hpp>
+#include <cppbugs/mcmc.arena.hpp>
 #include <cppbugs/mcmc.object.hpp>
 #include <cppbugs/mcmc.stochastic.hpp>
 #include <cppbugs/mcmc.observed.hpp>
 #include <cppbugs/mcmc.deterministic.hpp>
+#include <cppbugs/mcmc.packable.hpp>
 #include <cppbugs/mcmc.tracked.hpp>
+#include <cppbugs/mcmc.batch.means.hpp>
+#include <cppbugs/mcmc.dual.averaging.hpp>
+#include <cppbugs/mcmc.serialize.hpp>
 #include <cppbugs/mcmc.gcc.version.hpp>
 #include <cppbugs/deterministics/mcmc.lambda.hpp>
 
@@ -37,30 +49,319 @@ namespace cppbugs {
 
   class MCModel {
   private:
+    // nodes, trackers and captured hyperparameters all live here
+    // and are released in one shot when the model goes away
+    MCArena arena_;
     RngBase& rng_;
     double accepted_,rejected_,logp_value_,old_logp_value_;
+    // inverse temperature on the likelihood (observed nodes), for tempering
+    double beta_;
     std::vector<MCMCObject*> mcmcObjects, jumping_nodes, dynamic_nodes, deterministic_nodes;
-    std::vector<Stochastic*> stochastic_nodes;
+    std::vector<Stochastic*> stochastic_nodes, observed_nodes, prior_nodes;
     std::vector<MCMCTracked*> tracked_nodes;
 
-    //void jump() { for(auto v : jumping_nodes) { v->jump(rng_); } }
-    void jump() { for(auto v : dynamic_nodes) { v->jump(rng_); } }
+    // flat parameter vector: packable jumping nodes are mirrored in flat_,
+    // proposals are written to spare_ in one pass and handed to the nodes'
+    // own double buffers; jump and revert swap flat_ and spare_ along with them
+    arma::vec flat_, spare_;
+    std::vector<Packable*> jumping_packed; // parallel to jumping_nodes, NULL if not packed
+    std::vector<size_t> jumping_offsets;
+    bool packed_;
+    // false once node values may have changed outside of flat_ (per node
+    // tuning, or the caller between runs); the next step copies them in
+    bool flat_current_;
+
+    // a vector node whose elements are conditionally independent: element i of
+    // the node and of each of its dependents only involve element i of the node
+    struct IndependentBlock {
+      MCMCObject* node;
+      Packable* packed;
+      std::vector<Stochastic*> terms; // the node itself, then its dependents
+      std::vector<bool> tempered;     // terms that are observed
+      arma::vec x, x_prop, logp, logp_prop, scratch;
+    };
+    std::vector<IndependentBlock*> independent_blocks;
+
+    // run control: the loops check these every check_every_ iterations
+    typedef std::chrono::steady_clock clock;
+    std::function<void (const char*, int, int)> progress_;
+    int check_every_;
+    std::atomic<bool> cancel_;
+
+    DualAveraging global_adapt_;
+    std::vector<double> global_scales_;
+
+    // periodic checkpoints, built on the sampling thread and written in the background
+    std::string checkpoint_path_;
+    int checkpoint_every_;
+    BackgroundWriter checkpoint_writer_;
+    std::string resumed_phase_;
+    int resumed_iteration_;
+    // the draws log of the last checkpoint path: its size once everything
+    // submitted is written, and whether it must be cut back to that size first
+    std::string log_path_;
+    uint64_t log_bytes_;
+    bool log_truncate_;
+
+    void pack() {
+      if(packed_) { return; }
+      jumping_packed.clear();
+      jumping_offsets.clear();
+      size_t n(0);
+      for(auto node : jumping_nodes) {
+        Packable* pp = dynamic_cast<Packable*>(node);
+        if(pp && pp->packed_size() == 0) { pp = NULL; }
+        jumping_packed.push_back(pp);
+        jumping_offsets.push_back(n);
+        if(pp) { n += pp->packed_size(); }
+      }
+      flat_.set_size(n);
+      spare_.set_size(n);
+      bind(true);
+      packed_ = true;
+      flat_current_ = true;
+    }
+
+    // propose every element at once, then accept or reject each one on its own
+    // returns the change in the model's log density
+    void loglik_elements(IndependentBlock& blk, arma::vec& ans) {
+      ans.zeros();
+      for(size_t j = 0; j < blk.terms.size(); j++) {
+        if(beta_ != 1 && blk.tempered[j]) {
+          blk.scratch.zeros(ans.n_elem);
+          blk.terms[j]->loglik_elements(blk.scratch);
+          ans += beta_ * blk.scratch;
+        } else {
+          blk.terms[j]->loglik_elements(ans);
+        }
+      }
+    }
+
+    double step_independent(IndependentBlock& blk) {
+      // pick up changes made outside of this block
+      blk.packed->bind(blk.x.memptr(), true);
+      loglik_elements(blk, blk.logp);
+
+      blk.packed->propose(rng_, blk.x_prop.memptr(), blk.x.memptr());
+      blk.x.swap(blk.x_prop);
+      blk.packed->bind(blk.x.memptr(), false);
+      jump_detrministics();
+      loglik_elements(blk, blk.logp_prop);
+
+      // x_prop now holds the previous state
+      double delta(0);
+      for(size_t i = 0; i < blk.x.n_elem; i++) {
+        const double diff = blk.logp_prop[i] - blk.logp[i];
+        if(reject(blk.logp_prop[i], blk.logp[i])) {
+          blk.x[i] = blk.x_prop[i];
+          blk.node->reject();
+        } else {
+          delta += diff;
+          blk.node->accept();
+        }
+      }
+      blk.packed->bind(blk.x.memptr(), false);
+      jump_detrministics();
+      return delta;
+    }
+
+    // the layout of the flat vector is rebuilt on the next pack
+    void unpack() { packed_ = false; }
+
+    // copy: push the nodes' current values into flat_, else write flat_ back into the nodes
+    void bind(const bool copy) {
+      for(size_t i = 0; i < jumping_packed.size(); i++) {
+        if(jumping_packed[i]) { jumping_packed[i]->bind(flat_.memptr() + jumping_offsets[i], copy); }
+      }
+    }
+
+    void jump() {
+      for(size_t i = 0; i < jumping_nodes.size(); i++) {
+        if(jumping_packed[i]) {
+          const size_t offset = jumping_offsets[i];
+          jumping_packed[i]->propose(rng_, spare_.memptr() + offset, flat_.memptr() + offset);
+        } else {
+          jumping_nodes[i]->jump(rng_);
+        }
+      }
+      flat_.swap(spare_);
+      for(size_t i = 0; i < jumping_packed.size(); i++) {
+        if(jumping_packed[i]) { jumping_packed[i]->install(flat_.memptr() + jumping_offsets[i]); }
+      }
+      jump_detrministics();
+    }
+
+    void assign_state(const arma::vec& x) {
+      if(x.n_elem != state_size()) {
+        throw std::logic_error("ERROR: state size does not match the model.");
+      }
+      const double* p = x.memptr();
+      std::copy(p, p + flat_.n_elem, flat_.memptr());
+      p += flat_.n_elem;
+      bind(false);
+      for(auto blk : independent_blocks) {
+        std::copy(p, p + blk->x.n_elem, blk->x.memptr());
+        p += blk->x.n_elem;
+        blk->packed->bind(blk->x.memptr(), false);
+      }
+      jump_detrministics();
+    }
+
     void jump_detrministics() { for(size_t i = 0; i < deterministic_nodes.size(); i++) { deterministic_nodes[i]->jump(rng_); } }
-    void preserve() { for(auto v : dynamic_nodes) { v->preserve(); } }
-    void revert() { for(auto v : dynamic_nodes) { v->revert(); } }
+    void preserve() {
+      if(!flat_current_) {
+        bind(true);
+        flat_current_ = true;
+      }
+      for(auto v : dynamic_nodes) { v->preserve(); }
+    }
+    // packed nodes took their proposal through their own double buffer (see
+    // install), so both undo by swapping buffers
+    void revert() {
+      flat_.swap(spare_);
+      for(auto v : dynamic_nodes) { v->revert(); }
+    }
     void set_scale(const double scale) { for(auto v : jumping_nodes) { v->setScale(scale); } }
-    void tally() { for(auto v : tracked_nodes) { v->track(); } }
-    static bool bad_logp(const double value) { return std::isnan(value) || value == -std::numeric_limits<double>::infinity() ? true : false; }
-  public:
-    MCModel(RngBase& rng): rng_(rng), accepted_(0), rejected_(0), logp_value_(-std::numeric_limits<double>::infinity()), old_logp_value_(-std::numeric_limits<double>::infinity()) {}
-    ~MCModel() {
-      // only objects allocated by this class are inserted thre
-      // addNode allows user allocated objects to enter the mcmcObjects vector
-      for(auto m : mcmcObjects) {
-        delete m;
+
+    double global_target_ar() const {
+      double total_size = 0;
+      for(auto node : jumping_nodes) {
+        total_size += node->size();
+      }
+      return std::max(1/log2(total_size + 3), 0.234);
+    }
+
+    // global tuning: dual averaging of one log multiplier on the scales
+    // the nodes had when the run started
+    void start_global() {
+      global_scales_.clear();
+      for(auto node : jumping_nodes) { global_scales_.push_back(node->getScale()); }
+      global_adapt_.restart(0);
+      resetAcceptanceRatio();
+    }
+
+    void set_global(const double log_multiplier) {
+      for(size_t i = 0; i < jumping_nodes.size(); i++) {
+        jumping_nodes[i]->setScale(global_scales_[i] * exp(log_multiplier));
       }
     }
 
+    void adapt_global(const double target_ar) {
+      const double ar = acceptance_ratio();
+      resetAcceptanceRatio();
+      if(!std::isnan(ar)) { set_global(global_adapt_.update(ar, target_ar)); }
+      tune_independent();
+    }
+
+    void finish_global() {
+      if(global_adapt_.running()) { set_global(global_adapt_.average()); }
+      global_adapt_.stop();
+      for(auto blk : independent_blocks) { blk->node->finishTuning(); }
+    }
+
+    // every sampled node: jumping nodes, then the independent ones
+    std::vector<MCMCObject*> parameter_nodes() const {
+      std::vector<MCMCObject*> ans(jumping_nodes);
+      for(auto blk : independent_blocks) { ans.push_back(blk->node); }
+      return ans;
+    }
+
+    // true if the loop should stop (cancelled or past its deadline)
+    bool interrupted(const char* phase, const int i, const int iterations, const clock::time_point& deadline = clock::time_point::max()) {
+      if(progress_) { progress_(phase, i, iterations); }
+      return cancel_.load(std::memory_order_relaxed) || (deadline != clock::time_point::max() && clock::now() >= deadline);
+    }
+
+    int sample_impl(int iterations, int thin, const clock::time_point& deadline) {
+      flat_current_ = false;
+      int i = 1;
+      for(; i <= iterations; i++) {
+        step();
+        if(i % thin == 0) { tally(); }
+        if(checkpoint_every_ && i % checkpoint_every_ == 0) { checkpoint_async("sample", i); }
+        if(i % check_every_ == 0 && interrupted("sample", i, iterations, deadline)) { break; }
+      }
+      return std::min(i, iterations);
+    }
+
+    static const char* tuning_magic() { return "CPPBUGSA"; }
+    static const char* checkpoint_magic() { return "CPPBUGSC"; }
+    static const char* log_magic() { return "CPPBUGSL"; }
+    static std::string log_file(const std::string& path) { return path + ".draws"; }
+
+    void check_checkpointable() const {
+      for(auto v : tracked_nodes) {
+        if(!v->checkpointable()) {
+          throw std::logic_error("ERROR: a tracked container can't be checkpointed (use std::vector, RunningStats, QuantileSketch or ThinnedHistory).");
+        }
+      }
+    }
+
+    // each checkpoint path has its own log, so a new path starts every history over
+    // returns the size to cut the log back to before the next append (or no_truncate)
+    uint64_t start_log(const std::string& path) {
+      if(path != log_path_) {
+        for(auto v : tracked_nodes) { v->rewind(); }
+        log_path_ = path;
+        log_bytes_ = 0;
+        log_truncate_ = true;
+      }
+      const uint64_t ans = log_truncate_ ? log_bytes_ : no_truncate;
+      log_truncate_ = false;
+      return ans;
+    }
+
+    // everything needed to continue the chain bit for bit; the draws tallied
+    // since the previous checkpoint go to log, to be appended to the log file
+    BinaryWriter snapshot(const std::string& phase, const int iteration, std::string& log) {
+      const std::vector<MCMCObject*> nodes = parameter_nodes();
+      arma::vec state;
+      getState(state);
+
+      BinaryWriter out(checkpoint_magic(), 2, structure_key());
+      out.put(phase);
+      out.put(static_cast<uint64_t>(iteration));
+      out.put(rng_.save());
+      out.put(accepted_);
+      out.put(rejected_);
+      out.put(logp_value_);
+      out.put(static_cast<uint64_t>(nodes.size()));
+      for(auto node : nodes) {
+        out.put(node->getScale());
+        out.put(node->getElementScales());
+      }
+      out.put(state);
+      for(size_t i = 0; i < jumping_nodes.size(); i++) {
+        if(!jumping_packed[i]) { jumping_nodes[i]->save_value(out); }
+      }
+
+      BinaryWriter chunk = log_bytes_ ? BinaryWriter() : BinaryWriter(log_magic(), 1, structure_key());
+      BinaryWriter records;
+      for(auto v : tracked_nodes) { v->save(records, chunk); }
+      log_bytes_ += chunk.bytes().size();
+      log.swap(chunk.bytes());
+      out.put(log_bytes_);
+      out.put(static_cast<uint64_t>(tracked_nodes.size()));
+      out.bytes() += records.bytes();
+      return out;
+    }
+
+    void checkpoint_async(const char* phase, const int iteration) {
+      const uint64_t truncate_to = start_log(checkpoint_path_);
+      std::string log;
+      BinaryWriter out = snapshot(phase, iteration, log);
+      checkpoint_writer_.append(log_file(checkpoint_path_), log, truncate_to);
+      checkpoint_writer_.submit(checkpoint_path_, out.bytes());
+    }
+
+    static bool bad_logp(const double value) { return std::isnan(value) || value == -std::numeric_limits<double>::infinity() ? true : false; }
+
+    // copies an rvalue hyperparameter into the arena so the node can hold a reference to it
+    template<typename U>
+    const U& capture(const U&& a) { return *arena_.create<U>(std::move(a)); }
+  public:
+    MCModel(RngBase& rng): rng_(rng), accepted_(0), rejected_(0), logp_value_(-std::numeric_limits<double>::infinity()), old_logp_value_(-std::numeric_limits<double>::infinity()), beta_(1), packed_(false), flat_current_(false), check_every_(100), cancel_(false), checkpoint_every_(0), resumed_iteration_(0), log_bytes_(0), log_truncate_(false) {}
+
     double acceptance_ratio() const {
       return accepted_ / (accepted_ + rejected_);
     }
@@ -70,6 +371,12 @@ namespace cppbugs {
     }
 
     double logp() const {
+      if(beta_ == 0) {
+        return log_prior();
+      }
+      if(beta_ != 1) {
+        return log_prior() + beta_ * log_likelihood();
+      }
       double ans(0);
       for(auto node : stochastic_nodes) {
         ans += node->loglik();
@@ -77,6 +384,35 @@ namespace cppbugs {
       return ans;
     }
 
+    double log_likelihood() const {
+      double ans(0);
+      for(auto node : observed_nodes) {
+        ans += node->loglik();
+      }
+      return ans;
+    }
+
+    double log_prior() const {
+      double ans(0);
+      for(auto node : prior_nodes) {
+        ans += node->loglik();
+      }
+      return ans;
+    }
+
+    // target prior * likelihood^beta (0 <= beta <= 1) instead of the posterior
+    void setBeta(const double beta) {
+      if(!(beta >= 0 && beta <= 1)) {
+        throw std::logic_error("ERROR: beta must be in [0,1].");
+      }
+      beta_ = beta;
+      if(packed_) { logp_value_ = logp(); }
+    }
+    double getBeta() const { return beta_; }
+
+    // record the current values of the tracked nodes (as sample does)
+    void tally() { for(auto v : tracked_nodes) { v->track(); } }
+
     void resetAcceptanceRatio() {
       accepted_ = 0;
       rejected_ = 0;
@@ -103,17 +439,96 @@ namespace cppbugs {
             it->accept();
           }
 	}
+        if(!independent_blocks.empty()) {
+          // a reverted node leaves the deterministics at its rejected proposal
+          jump_detrministics();
+          for(auto blk : independent_blocks) {
+            logp_value = add_logp(logp_value, step_independent(*blk));
+          }
+        }
 	if(i % tuning_step == 0) {
           //std::cout << "tuning at step: " << i << std::endl;
 	  for(auto it : jumping_nodes) {
 	    it->tune();
 	  }
+          tune_independent();
 	}
+        if(i % check_every_ == 0 && interrupted("tune", i, iterations)) { break; }
       }
+      for(auto it : jumping_nodes) { it->finishTuning(); }
+      flat_current_ = false;
+      for(auto blk : independent_blocks) { blk->node->finishTuning(); }
+    }
+
+    // all packable unobserved parameters as one flat vector, for samplers
+    // that work on the whole state (nodes that can't be packed are not included)
+    // (independent nodes follow the packed ones)
+    size_t state_size() {
+      pack();
+      size_t n = flat_.n_elem;
+      for(auto blk : independent_blocks) { n += blk->x.n_elem; }
+      return n;
+    }
+
+    // true if the flat state holds every unobserved parameter, so that
+    // getState / setState capture and restore the whole model
+    bool state_complete() {
+      pack();
+      return std::find(jumping_packed.begin(), jumping_packed.end(), static_cast<Packable*>(NULL)) == jumping_packed.end();
     }
 
+    void getState(arma::vec& x) {
+      x.set_size(state_size());
+      bind(true);
+      double* p = std::copy(flat_.memptr(), flat_.memptr() + flat_.n_elem, x.memptr());
+      for(auto blk : independent_blocks) {
+        blk->packed->bind(blk->x.memptr(), true);
+        p = std::copy(blk->x.memptr(), blk->x.memptr() + blk->x.n_elem, p);
+      }
+    }
+
+    // support of each element of the flat state, -inf / inf where unbounded
+    void state_support(arma::vec& lower, arma::vec& upper) {
+      const size_t n = state_size();
+      lower.set_size(n);
+      upper.set_size(n);
+      lower.fill(-std::numeric_limits<double>::infinity());
+      upper.fill(std::numeric_limits<double>::infinity());
+      for(size_t i = 0; i < jumping_packed.size(); i++) {
+        if(jumping_packed[i]) { jumping_packed[i]->support(lower.memptr() + jumping_offsets[i], upper.memptr() + jumping_offsets[i]); }
+      }
+      size_t offset = flat_.n_elem;
+      for(auto blk : independent_blocks) {
+        blk->packed->support(lower.memptr() + offset, upper.memptr() + offset);
+        offset += blk->x.n_elem;
+      }
+    }
+
+    void setState(const arma::vec& x) {
+      assign_state(x);
+      logp_value_ = logp();
+    }
+
+    // log density at a flat state (the model is left at that state)
+    double logp_at(const arma::vec& x) {
+      setState(x);
+      return logp_value_;
+    }
+
+    // prior and likelihood parts of logp at a flat state (the model is left at that state)
+    void logp_parts_at(const arma::vec& x, double& prior, double& likelihood) {
+      assign_state(x);
+      prior = log_prior();
+      likelihood = log_likelihood();
+      logp_value_ = beta_ == 0 ? prior : prior + beta_ * likelihood;
+    }
+
+    // one metropolis step over the packed nodes, then the independent ones.
+    // values changed by hand are picked up at the start of the next tune,
+    // burn or sample call, not between bare calls to step() (use setState)
     void step() {
       old_logp_value_ = logp_value_;
+      pack();
       preserve();
       jump();
       logp_value_ = logp();
@@ -124,52 +539,291 @@ namespace cppbugs {
       } else {
         accepted_ += 1;
       }
+      for(auto blk : independent_blocks) {
+        logp_value_ = add_logp(logp_value_, step_independent(*blk));
+      }
     }
 
-    void tune_global(int iterations, int tuning_step) {
-      const double thresh = 0.1;
-      // FIXME: this should possibly related to the overall size/dimension
-      // of the parmaeters to be estimtated, as there is somewhat of a leverage effect
-      // via the number of parameters
-      const double dilution = 0.10;
-      double total_size = 0;
+    // fall back to a full evaluation when the incremental update isn't usable (i.e. -Inf + Inf)
+    double add_logp(const double value, const double delta) const {
+      const double ans = value + delta;
+      return std::isfinite(ans) ? ans : logp();
+    }
+
+    // independent nodes are tuned on their own (elementwise) acceptance ratio
+    void tune_independent() {
+      for(auto blk : independent_blocks) { blk->node->tune(); }
+    }
 
-      for(size_t i = 0; i < dynamic_nodes.size(); i++) {
-        if(dynamic_cast<Stochastic*>(dynamic_nodes[i])) {
-          total_size += dynamic_nodes[i]->size();
+    void tune_global(int iterations, int tuning_step) {
+      flat_current_ = false;
+      const double target_ar = global_target_ar();
+      start_global();
+      for(int i = 1; i <= iterations; i++) {
+        step();
+        if(i % tuning_step == 0) {
+          adapt_global(target_ar);
         }
+        if(i % check_every_ == 0 && interrupted("tune_global", i, iterations)) { break; }
       }
-      double target_ar = std::max(1/log2(total_size + 3), 0.234);
-      for(int i = 1; i <= iterations; i++) {
+      finish_global();
+    }
+
+    // warmup w/ global tuning (as tune_global) that stops as soon as the chain
+    // looks stationary: split R-hat of the batch means of logp and of every packed
+    // parameter over the latter half of the run must be below rhat_threshold
+    // returns the number of iterations used
+    int warmup(int min_iterations, int max_iterations, int tuning_step = 100, double rhat_threshold = 1.05) {
+      flat_current_ = false;
+      const double target_ar = global_target_ar();
+      BatchMeans monitor(tuning_step);
+      start_global();
+      arma::vec state, x;
+      int i = 1;
+      for(; i <= max_iterations; i++) {
         step();
+        getState(state);
+        x.set_size(state.n_elem + 1);
+        std::copy(state.memptr(), state.memptr() + state.n_elem, x.memptr());
+        x[state.n_elem] = logp_value_;
+        monitor.push_back(x);
         if(i % tuning_step == 0) {
-          double diff = acceptance_ratio() - target_ar;
-          resetAcceptanceRatio();
-          if(std::abs(diff) > thresh) {
-            double adj_factor = (1.0 + diff * dilution);
-            for(size_t i = 0; i < dynamic_nodes.size(); i++) {
-              dynamic_nodes[i]->setScale(dynamic_nodes[i]->getScale() * adj_factor);
-            }
-          }
+          adapt_global(target_ar);
+          // NaN (not enough batches yet) never passes
+          if(i >= min_iterations && arma::all(monitor.rhat() < rhat_threshold)) { break; }
         }
+        if(i % check_every_ == 0 && interrupted("warmup", i, max_iterations)) { break; }
       }
+      finish_global();
+      resetAcceptanceRatio();
+      return std::min(i, max_iterations);
     }
 
-    void burn(int iterations) {
-      for(int i = 0; i < iterations; i++) {
+    // burn and sample return the number of iterations run, which is less
+    // than requested only if the run was cancelled
+    int burn(int iterations) {
+      flat_current_ = false;
+      int i = 1;
+      for(; i <= iterations; i++) {
         step();
+        if(checkpoint_every_ && i % checkpoint_every_ == 0) { checkpoint_async("burn", i); }
+        if(i % check_every_ == 0 && interrupted("burn", i, iterations)) { break; }
       }
+      return std::min(i, iterations);
     }
 
-    void sample(int iterations, int thin) {
-      for(int i = 1; i <= iterations; i++) {
+    int sample(int iterations, int thin) {
+      return sample_impl(iterations, thin, clock::time_point::max());
+    }
+
+    // sample (as sample) until the time budget is used up
+    template<typename Rep, typename Period>
+    int sample_for(const std::chrono::duration<Rep,Period>& budget, int thin = 1, int max_iterations = std::numeric_limits<int>::max() - 1) {
+      return sample_impl(max_iterations, thin, clock::now() + std::chrono::duration_cast<clock::duration>(budget));
+    }
+
+    // f(phase, iteration, iterations) is called every `every` iterations
+    // of tune, tune_global, warmup, burn and the sample loops
+    void set_progress(std::function<void (const char*, int, int)> f, int every = 100) {
+      if(every < 1) { throw std::logic_error("ERROR: progress interval must be positive."); }
+      progress_ = f;
+      check_every_ = every;
+    }
+
+    // safe to call from another thread; running and later loops return at
+    // their next check until reset_cancel() is called
+    void cancel() { cancel_.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancel_.load(std::memory_order_relaxed); }
+    void reset_cancel() { cancel_.store(false, std::memory_order_relaxed); }
+
+    // sample (as sample) until every tracked quantity has reached target_ess
+    // effective draws, judged by batch means of the tallied values; returns
+    // the number of iterations run (at most max_iterations)
+    int sample_until(double target_ess, int max_iterations, int thin = 1) {
+      flat_current_ = false;
+      size_t n(0);
+      for(auto v : tracked_nodes) { n += v->value_size(); }
+      if(n == 0) {
+        throw std::logic_error("ERROR: sample_until needs at least one tracked node.");
+      }
+      BatchMeans monitor;
+      arma::vec x(n);
+      int i = 1;
+      for(; i <= max_iterations; i++) {
         step();
-        if(i % thin == 0) { tally(); }
+        if(i % thin == 0) {
+          tally();
+          double* p = x.memptr();
+          for(auto v : tracked_nodes) {
+            v->copy_value(p);
+            p += v->value_size();
+          }
+          monitor.push_back(x);
+          // re-estimate once per completed batch, NaN never passes
+          if(monitor.size() % monitor.batch_size() == 0 && arma::all(monitor.ess() >= target_ess)) { break; }
+        }
+        if(i % check_every_ == 0 && interrupted("sample", i, max_iterations)) { break; }
+      }
+      return std::min(i, max_iterations);
+    }
+
+    // model structure, as the type and size of every sampled node
+    // (observed data may change size without changing the key)
+    uint64_t structure_key() const {
+      uint64_t h = fnv1a(NULL, 0);
+      for(auto node : parameter_nodes()) {
+        const char* name = typeid(*node).name();
+        const double n = node->size();
+        h = fnv1a(name, std::strlen(name), h);
+        h = fnv1a(&n, sizeof(n), h);
+      }
+      return h;
+    }
+
+    // adapted scales and the last state, so that a later run of the same
+    // model can start from here and skip most of tuning and burn in
+    void save_tuning(const std::string& path) {
+      const std::vector<MCMCObject*> nodes = parameter_nodes();
+      arma::vec state;
+      getState(state);
+
+      BinaryWriter out(tuning_magic(), 1, structure_key());
+      out.put(static_cast<uint64_t>(nodes.size()));
+      for(auto node : nodes) {
+        out.put(node->getScale());
+        out.put(node->getElementScales());
+      }
+      out.put(state);
+      out.write(path);
+    }
+
+    // returns false, leaving the model untouched, if there is no saved state
+    // at path, it can't be read (truncated, or not a tuning file, or its
+    // scales don't fit the nodes), or it was saved by a model of a different structure
+    bool load_tuning(const std::string& path) {
+      const std::vector<MCMCObject*> nodes = parameter_nodes();
+      std::vector<double> scales(nodes.size());
+      std::vector<arma::vec> element_scales(nodes.size());
+      arma::vec state;
+
+      // read everything before touching the model
+      try {
+        BinaryReader in(path, tuning_magic());
+        if(!in.good() || in.version() != 1 || in.key() != structure_key()) { return false; }
+        if(in.get_u64() != nodes.size()) { return false; }
+        for(size_t i = 0; i < nodes.size(); i++) {
+          scales[i] = in.get_double();
+          element_scales[i] = in.get_vec();
+        }
+        state = in.get_vec();
+      } catch(std::runtime_error&) {
+        return false;
+      }
+      if(state.n_elem != state_size()) { return false; }
+      // checked here, as setElementScales throwing half way would leave the model partly retuned
+      for(size_t i = 0; i < nodes.size(); i++) {
+        if(element_scales[i].n_elem && element_scales[i].n_elem != nodes[i]->size()) { return false; }
+      }
+
+      for(size_t i = 0; i < nodes.size(); i++) {
+        nodes[i]->setScale(scales[i]);
+        nodes[i]->setElementScales(element_scales[i]);
+      }
+      setState(state);
+      return true;
+    }
+
+    // write a checkpoint now (synchronously)
+    // the tracked histories go to an append only log, path.draws, of which each
+    // checkpoint only writes the draws tallied since the one before; node values
+    // that aren't in the flat state (i.e. integer or Wishart nodes) are saved too
+    void checkpoint(const std::string& path) {
+      check_checkpointable();
+      checkpoint_writer_.flush();
+      const uint64_t truncate_to = start_log(path);
+      std::string log;
+      BinaryWriter out = snapshot("", 0, log);
+      append_file(log_file(path), log, truncate_to);
+      out.write(path);
+    }
+
+    // burn and sample write a checkpoint to path every `every` iterations;
+    // the sampler only builds the record, the files are written in the background
+    // (every = 0 turns this off)
+    void set_checkpoint(const std::string& path, int every) {
+      if(every < 0) { throw std::logic_error("ERROR: checkpoint interval must not be negative."); }
+      if(every) { check_checkpointable(); }
+      checkpoint_writer_.flush();
+      checkpoint_path_ = path;
+      checkpoint_every_ = every;
+    }
+
+    // wait for any pending checkpoint to be written
+    void flush_checkpoint() { checkpoint_writer_.flush(); }
+
+    // continue from a checkpoint; returns false if there is none at path
+    // resumed_phase() and resumed_iteration() tell where it was taken (i.e.
+    // sample(n - resumed_iteration(), thin) finishes an interrupted sample(n, thin)
+    // bit for bit, as long as thin divides the checkpoint interval)
+    bool restore(const std::string& path) {
+      BinaryReader in(path, checkpoint_magic());
+      if(!in.good()) { return false; }
+      if(in.version() != 2 || in.key() != structure_key()) {
+        throw std::logic_error("ERROR: checkpoint was written by a different model: " + path);
+      }
+      const std::vector<MCMCObject*> nodes = parameter_nodes();
+      resumed_phase_ = in.get_string();
+      resumed_iteration_ = static_cast<int>(in.get_u64());
+      rng_.load(in.get_string());
+      accepted_ = in.get_double();
+      rejected_ = in.get_double();
+      const double logp_value = in.get_double();
+      if(in.get_u64() != nodes.size()) { throw std::runtime_error("ERROR: corrupt checkpoint: " + path); }
+      for(auto node : nodes) {
+        node->setScale(in.get_double());
+        node->setElementScales(in.get_vec());
+      }
+      const arma::vec state = in.get_vec();
+      if(state.n_elem != state_size()) { throw std::runtime_error("ERROR: corrupt checkpoint: " + path); }
+      for(size_t i = 0; i < jumping_nodes.size(); i++) {
+        if(!jumping_packed[i]) { jumping_nodes[i]->load_value(in); }
       }
+      setState(state);
+      logp_value_ = logp_value;
+
+      // histories are rebuilt from the log, up to where this checkpoint was taken
+      // (a crashed run may have logged more), then checked against the records
+      const uint64_t log_bytes = in.get_u64();
+      if(in.get_u64() != tracked_nodes.size()) { throw std::logic_error("ERROR: checkpoint has a different set of trackers: " + path); }
+      BinaryReader log(log_file(path), log_magic());
+      if(!log.good() || log.key() != structure_key()) { throw std::runtime_error("ERROR: missing checkpoint log: " + log_file(path)); }
+      while(log.tell() < log_bytes) {
+        const size_t at = log.tell();
+        for(auto v : tracked_nodes) { v->replay(log); }
+        if(log.tell() == at) { break; }
+      }
+      if(log.tell() != log_bytes) { throw std::runtime_error("ERROR: corrupt checkpoint log: " + log_file(path)); }
+      for(auto v : tracked_nodes) { v->load(in); }
+      log_path_ = path;
+      log_bytes_ = log_bytes;
+      log_truncate_ = true;
+      return true;
+    }
+
+    const std::string& resumed_phase() const { return resumed_phase_; }
+    int resumed_iteration() const { return resumed_iteration_; }
+
+    // storage owned by the model (i.e. the values of a replica built by a
+    // function), released along with the nodes
+    template<typename T, typename... Args>
+    T& make(Args&&... args) {
+      return *arena_.create<T>(std::forward<Args>(args)...);
     }
 
     template<typename T>
     void addNode(MCMCObject* node) {
+      // layout of the flat vector changes, rebuilt on the next step
+      unpack();
       mcmcObjects.push_back(node);
       // test object for traits
       Stochastic* sp = dynamic_cast<Stochastic*>(node);
@@ -179,6 +833,7 @@ namespace cppbugs {
 
       if(sp) {
         stochastic_nodes.push_back(sp);
+        if(op) { observed_nodes.push_back(sp); } else { prior_nodes.push_back(sp); }
         if(sp->loglik()==-std::numeric_limits<double>::infinity()) {
           throw std::logic_error("Cannot start from -Inf.");
         }
@@ -192,130 +847,200 @@ namespace cppbugs {
 
     template<typename T, typename U>
     Lambda1<T, U>& lambda(T& x, std::function<const T(const U&)> f, const U& a) {
-      Lambda1<T, U>* node = new Lambda1<T, U>(x, f, a);
+      Lambda1<T, U>* node = arena_.create<Lambda1<T, U> >(x, f, a);
       addNode<T>(node);
       return *node;
     }
 
     template<typename T, typename U, typename V>
     Lambda2<T, U, V>& lambda(T& x, std::function<const T(const U&,const V&)> f, const U& a, const V& b) {
-      Lambda2<T, U, V>* node = new Lambda2<T, U, V>(x, f, a, b);
+      Lambda2<T, U, V>* node = arena_.create<Lambda2<T, U, V> >(x, f, a, b);
       addNode<T>(node);
       return *node;
     }
 
     template<typename T, typename U, typename V, typename W>
     Lambda3<T, U, V, W>& lambda(T& x, std::function<const T(const U&,const V&,const W&)> f, const U& a, const V& b, const W& c) {
-      Lambda3<T, U, V, W>* node = new Lambda3<T, U, V, W>(x, f, a, b, c);
+      Lambda3<T, U, V, W>* node = arena_.create<Lambda3<T, U, V, W> >(x, f, a, b, c);
       addNode<T>(node);
       return *node;
     }
 
     template<typename T, typename U, typename V, typename W, typename X>
     Lambda4<T, U, V, W, X>& lambda(T& x, std::function<const T(const U&,const V&,const W&, const X&)> f, const U& a, const V& b, const W& c, const X& d) {
-      Lambda4<T, U, V, W, X>* node = new Lambda4<T, U, V, W, X>(x, f, a, b, c, d);
+      Lambda4<T, U, V, W, X>* node = arena_.create<Lambda4<T, U, V, W, X> >(x, f, a, b, c, d);
+      addNode<T>(node);
+      return *node;
+    }
+
+    // step node with an elementwise accept/reject instead of jumping it jointly
+    // with the rest of the model.  the caller asserts that element i of node and
+    // of each dependent's log density depend on no other element of node.
+    // i.e. m.independent(overdisp_node, obs_node);
+    template<typename N, typename... D>
+    void independent(N& node, D&... dependents) {
+      const size_t n = flat_size(node.value);
+      if(n == 0) {
+        throw std::logic_error("ERROR: independent node must hold double values.");
+      }
+      const std::vector<double> dependent_sizes = { dim_size(dependents.value)... };
+      for(auto s : dependent_sizes) {
+        if(s != n) {
+          throw std::logic_error("ERROR: dependents of an independent node must be the same size as the node.");
+        }
+      }
+      auto it = std::find(jumping_nodes.begin(), jumping_nodes.end(), static_cast<MCMCObject*>(&node));
+      if(it == jumping_nodes.end()) {
+        throw std::logic_error("ERROR: independent node must be an unobserved stochastic of this model.");
+      }
+      // layout of the flat vector changes, rebuilt on the next step
+      unpack();
+      jumping_nodes.erase(it);
+
+      IndependentBlock* blk = arena_.create<IndependentBlock>();
+      blk->node = &node;
+      blk->packed = &node;
+      blk->terms = { static_cast<Stochastic*>(&node), static_cast<Stochastic*>(&dependents)... };
+      for(auto t : blk->terms) {
+        blk->tempered.push_back(std::find(observed_nodes.begin(), observed_nodes.end(), t) != observed_nodes.end());
+      }
+      blk->x.set_size(n);
+      blk->x_prop.set_size(n);
+      blk->logp.set_size(n);
+      blk->logp_prop.set_size(n);
+      node.bind(blk->x.memptr(), true);
+      independent_blocks.push_back(blk);
+    }
+
+    // f(x, a, ...) writes into x directly; prefer these over lambda() in hot models
+    template<typename T, typename F, typename U>
+    InPlaceLambda1<T, F, U>& lambda_inplace(T& x, F f, const U& a) {
+      InPlaceLambda1<T, F, U>* node = arena_.create<InPlaceLambda1<T, F, U> >(x, f, a);
+      addNode<T>(node);
+      return *node;
+    }
+
+    template<typename T, typename F, typename U, typename V>
+    InPlaceLambda2<T, F, U, V>& lambda_inplace(T& x, F f, const U& a, const V& b) {
+      InPlaceLambda2<T, F, U, V>* node = arena_.create<InPlaceLambda2<T, F, U, V> >(x, f, a, b);
+      addNode<T>(node);
+      return *node;
+    }
+
+    template<typename T, typename F, typename U, typename V, typename W>
+    InPlaceLambda3<T, F, U, V, W>& lambda_inplace(T& x, F f, const U& a, const V& b, const W& c) {
+      InPlaceLambda3<T, F, U, V, W>* node = arena_.create<InPlaceLambda3<T, F, U, V, W> >(x, f, a, b, c);
+      addNode<T>(node);
+      return *node;
+    }
+
+    template<typename T, typename F, typename U, typename V, typename W, typename X>
+    InPlaceLambda4<T, F, U, V, W, X>& lambda_inplace(T& x, F f, const U& a, const V& b, const W& c, const X& d) {
+      InPlaceLambda4<T, F, U, V, W, X>* node = arena_.create<InPlaceLambda4<T, F, U, V, W, X> >(x, f, a, b, c, d);
       addNode<T>(node);
       return *node;
     }
 
     template<template<typename,typename> class MCTYPE, typename T, typename U>
     MCTYPE<T, U>& link(T& x, const U& a) {
-      MCTYPE<T, U>* node = new MCTYPE<T, U>(x, a);
+      MCTYPE<T, U>* node = arena_.create<MCTYPE<T, U> >(x, a);
       addNode<T>(node);
       return *node;
     }
 
     template<template<typename,typename,typename> class MCTYPE, typename T, typename U, typename V>
     MCTYPE<T, U, V>& link(T& x, const U& a, const V& b) {
-      MCTYPE<T, U, V>* node = new MCTYPE<T, U, V>(x, a, b);
+      MCTYPE<T, U, V>* node = arena_.create<MCTYPE<T, U, V> >(x, a, b);
       addNode<T>(node);
       return *node;
     }
 
     template<template<typename,typename,typename,typename> class MCTYPE, typename T, typename U, typename V, typename W>
     MCTYPE<T, U, V, W>& link(T& x, const U& a, const V& b, const W& c) {
-      MCTYPE<T, U, V, W>* node = new MCTYPE<T, U, V, W>(x, a, b, c);
+      MCTYPE<T, U, V, W>* node = arena_.create<MCTYPE<T, U, V, W> >(x, a, b, c);
       addNode<T>(node);
       return *node;
     }
 
     template<template<typename,typename,typename,typename,typename> class MCTYPE, typename T, typename U, typename V, typename W, typename X>
     MCTYPE<T, U, V, W, X>& link(T& x, const U& a, const V& b, const W& c, const X& d) {
-      MCTYPE<T, U, V, W, X>* node = new MCTYPE<T, U, V, W, X>(x, a, b, c, d);
+      MCTYPE<T, U, V, W, X>* node = arena_.create<MCTYPE<T, U, V, W, X> >(x, a, b, c, d);
       addNode<T>(node);
       return *node;
     }
 
     template<template<typename,typename,typename> class MCTYPE, typename T, typename U, typename V>
     MCTYPE<T, U, V>& link(const T& x, const U& a, const V& b) {
-      MCTYPE<T, U, V>* node = new MCTYPE<T, U, V>(x, a, b);
+      MCTYPE<T, U, V>* node = arena_.create<MCTYPE<T, U, V> >(x, a, b);
       addNode<T>(node);
       return *node;
     }
 
-#if GCC_VERSION > 40700
-    template<template<typename,typename,typename> class MCTYPE, typename T, typename U, typename V>
-    MCTYPE<T, U, V>& link(T& x, const U&& a, const V& b) {
-      MCTYPE<T, U, V>* node = new MCTYPE<T, U, V>(x, std::move(a), b);
+    template<template<typename,typename,typename,typename> class MCTYPE, typename T, typename U, typename V, typename W>
+    MCTYPE<T, U, V, W>& link(const T& x, const U& a, const V& b, const W& c) {
+      MCTYPE<T, U, V, W>* node = arena_.create<MCTYPE<T, U, V, W> >(x, a, b, c);
       addNode<T>(node);
       return *node;
     }
 
+#if GCC_VERSION > 40700 || defined(__clang__)
+    // rvalue hyperparameters are copied into the arena, then linked as lvalues
+    template<template<typename,typename> class MCTYPE, typename T, typename U>
+    MCTYPE<T, U>& link(T& x, const U&& a) {
+      return link<MCTYPE>(x, capture(std::move(a)));
+    }
+
+    template<template<typename,typename,typename> class MCTYPE, typename T, typename U, typename V>
+    MCTYPE<T, U, V>& link(T& x, const U&& a, const V& b) {
+      return link<MCTYPE>(x, capture(std::move(a)), b);
+    }
+
     template<template<typename,typename,typename> class MCTYPE, typename T, typename U, typename V>
     MCTYPE<T, U, V>& link(T& x, const U& a, const V&& b) {
-      MCTYPE<T, U, V>* node = new MCTYPE<T, U, V>(x, a, std::move(b));
-      addNode<T>(node);
-      return *node;
+      return link<MCTYPE>(x, a, capture(std::move(b)));
     }
 
     template<template<typename,typename,typename> class MCTYPE, typename T, typename U, typename V>
     MCTYPE<T, U, V>& link(T& x, const U&& a, const V&& b) {
-      MCTYPE<T, U, V>* node = new MCTYPE<T, U, V>(x, std::move(a), std::move(b));
-      addNode<T>(node);
-      return *node;
+      return link<MCTYPE>(x, capture(std::move(a)), capture(std::move(b)));
     }
 
     template<template<typename,typename,typename> class MCTYPE, typename T, typename U, typename V>
     MCTYPE<T, U, V>& link(const T& x, const U&& a, const V& b) {
-      MCTYPE<T, U, V>* node = new MCTYPE<T, U, V>(x, std::move(a), b);
-      addNode<T>(node);
-      return *node;
+      return link<MCTYPE>(x, capture(std::move(a)), b);
     }
 
     template<template<typename,typename,typename> class MCTYPE, typename T, typename U, typename V>
     MCTYPE<T, U, V>& link(const T& x, const U& a, const V&& b) {
-      MCTYPE<T, U, V>* node = new MCTYPE<T, U, V>(x, a, std::move(b));
-      addNode<T>(node);
-      return *node;
+      return link<MCTYPE>(x, a, capture(std::move(b)));
     }
 
     template<template<typename,typename,typename> class MCTYPE, typename T, typename U, typename V>
     MCTYPE<T, U, V>& link(const T& x, const U&& a, const V&& b) {
-      MCTYPE<T, U, V>* node = new MCTYPE<T, U, V>(x, std::move(a), std::move(b));
-      addNode<T>(node);
-      return *node;
+      return link<MCTYPE>(x, capture(std::move(a)), capture(std::move(b)));
     }
 #endif
 
     // this is for deterministic nodes
     template<template<typename> class MCTYPE, typename T>
     MCTYPE<T>& link(T& x) {
-      MCTYPE<T>* node = new MCTYPE<T>(x);
+      MCTYPE<T>* node = arena_.create<MCTYPE<T> >(x);
       addNode<T>(node);
       return *node;
     }
 
     template<template<typename U,class Alloc = std::allocator<U> > class CONTAINER, typename T>
     CONTAINER<T>& track(const T& x) {
-      MCMCTrackedT<T,CONTAINER>* node = new MCMCTrackedT<T,CONTAINER>(x);
+      MCMCTrackedT<T,CONTAINER>* node = arena_.create<MCMCTrackedT<T,CONTAINER> >(x);
       tracked_nodes.push_back(node);
       return node->history;
     }
 
-    // // allows node to be added without being put on the delete list
-    // // for those who want full control of their memory...
-    // void track(MCMCObject* node) {
-    //   mcmcObjects.push_back(node);
-    // }
+    // user owned trackers (i.e. a TraceSink), tallied along with the others
+    template<typename T>
+    T& track(T& tracker) {
+      tracked_nodes.push_back(&tracker);
+      return tracker;
+    }
   };
 } // namespace cppbugs
@@ -17,10 +17,15 @@
 
 #pragma once
 
+#include <stdexcept>
+#include <armadillo>
 #include <cppbugs/mcmc.rng.base.hpp>
 
 namespace cppbugs {
 
+  class BinaryWriter;
+  class BinaryReader;
+
   class MCMCObject {
   public:
     MCMCObject() {}
@@ -29,6 +34,8 @@ namespace cppbugs {
     virtual void accept() = 0;
     virtual void reject() = 0;
     virtual void tune() = 0;
+    // called at the end of a tuning run to settle on the final scale
+    virtual void finishTuning() {}
     virtual void preserve() = 0;
     virtual void revert() = 0;
     // virtual bool isDeterministc() const = 0;
@@ -36,6 +43,12 @@ namespace cppbugs {
     // virtual bool isObserved() const = 0;
     virtual void setScale(const double scale) = 0;
     virtual double getScale() const = 0;
+    // relative per element scales, empty if the node has none
+    virtual void setElementScales(const arma::vec& element_scale) {}
+    virtual arma::vec getElementScales() const { return arma::vec(); }
+    // checkpointing of jumping nodes the packed state doesn't cover (i.e. integer nodes)
+    virtual void save_value(BinaryWriter& out) const { throw std::logic_error("ERROR: this node can't be checkpointed."); }
+    virtual void load_value(BinaryReader& in) { throw std::logic_error("ERROR: this node can't be restored."); }
     virtual double size() const = 0;
   };
 
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <armadillo>
+#include <cppbugs/mcmc.rng.base.hpp>
+
+namespace cppbugs {
+
+  // nodes whose value can live inside the model's flat parameter vector
+  class Packable {
+  public:
+    Packable() {}
+    virtual ~Packable() {}
+    // number of doubles in the flat vector, 0 if the node cannot be packed
+    virtual size_t packed_size() const = 0;
+    // copy the value into mem if copy is set, else copy mem back into the value
+    virtual void bind(double* mem, const bool copy) = 0;
+    // write a proposal for this node's segment into out, given the current state in
+    virtual void propose(RngBase& rng, double* out, const double* in) const = 0;
+    // make mem (a proposal) the value, keeping the current value for revert()
+    // as a jump does
+    virtual void install(double* mem) = 0;
+    // bounds of each element's support, where finite (see unbounded_support)
+    virtual void support(double* lower, double* upper) const {}
+  };
+
+  size_t flat_size(const double& x) {
+    return 1;
+  }
+
+  size_t flat_size(const arma::mat& x) {
+    return x.n_elem;
+  }
+
+  size_t flat_size(const arma::vec& x) {
+    return x.n_elem;
+  }
+
+  size_t flat_size(const arma::rowvec& x) {
+    return x.n_elem;
+  }
+
+  // ints, bools and anything else stay where they are
+  template<typename T>
+  size_t flat_size(const T& x) {
+    return 0;
+  }
+
+  // the model's flat vector mirrors the value: copy set writes the value
+  // into mem, otherwise mem is written back into the value.  the caller's
+  // objects keep their own storage throughout
+  void flat_bind(double& x, double* mem, const bool copy) {
+    if(copy) {
+      *mem = x;
+    } else {
+      x = *mem;
+    }
+  }
+
+  template<typename T>
+  void flat_bind_arma(T& x, double* mem, const bool copy) {
+    if(copy) {
+      std::copy(x.memptr(), x.memptr() + x.n_elem, mem);
+    } else {
+      std::copy(mem, mem + x.n_elem, x.memptr());
+    }
+  }
+
+  void flat_bind(arma::mat& x, double* mem, const bool copy) { flat_bind_arma(x, mem, copy); }
+  void flat_bind(arma::vec& x, double* mem, const bool copy) { flat_bind_arma(x, mem, copy); }
+  void flat_bind(arma::rowvec& x, double* mem, const bool copy) { flat_bind_arma(x, mem, copy); }
+
+  template<typename T>
+  void flat_bind(T& x, double* mem, const bool copy) {}
+
+} // namespace cppbugs
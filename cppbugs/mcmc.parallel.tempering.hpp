@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include <condition_variable>
+#include <armadillo>
+#include <cppbugs/mcmc.arena.hpp>
+#include <cppbugs/mcmc.model.hpp>
+
+namespace cppbugs {
+
+  // replica exchange: K copies of a model built by the same function, replica k
+  // targeting prior * likelihood^beta_k (beta_0 = 1 is the posterior), each
+  // stepping on its own thread.  every swap_interval steps adjacent replicas
+  // (even pairs, then odd pairs) propose to exchange states; only the two
+  // replicas of a pair wait for each other
+  //
+  //   ParallelTempering<BoostRng<boost::mt19937> > pt([&](MCModel& m, const size_t k) {
+  //     vec& b = m.make<vec>(randn<vec>(2));
+  //     m.link<Normal>(b, 0, 0.001);
+  //     ...
+  //     if(k == 0) { b_hist = &m.track<std::vector>(b); }
+  //   }, 8);
+  //   pt.adapt_ladder(2e4); pt.tune(1e4,100); pt.burn(1e4); pt.sample(1e5,10);
+  //
+  // only replica 0 tallies.  swaps exchange states, so replica 0 always holds
+  // the posterior chain and each replica keeps the scales tuned for its beta
+  template<typename RNG>
+  class ParallelTempering {
+  public:
+    typedef std::function<void (MCModel&, const size_t)> Builder;
+  private:
+    // handshake between replicas k and k+1, each side records the last round it reached
+    struct Exchange {
+      std::mutex mutex;
+      std::condition_variable cv;
+      uint64_t ready, done;
+      double attempts, accepted;
+      Exchange(): ready(0), done(0), attempts(0), accepted(0) {}
+    };
+
+    MCArena arena_;
+    std::vector<RNG*> rngs_;
+    std::vector<MCModel*> models_;
+    std::vector<Exchange*> exchanges_;
+    std::vector<double> betas_;
+    const int swap_interval_;
+    uint64_t round_;
+    std::atomic<bool> failed_;
+
+    void swap_states(const size_t lower) {
+      Exchange& e = *exchanges_[lower];
+      MCModel& a = *models_[lower];
+      MCModel& b = *models_[lower + 1];
+      e.attempts += 1;
+      const double log_ratio = (betas_[lower] - betas_[lower + 1]) * (b.log_likelihood() - a.log_likelihood());
+      if(log(rngs_[lower]->uniform()) < log_ratio) {
+        arma::vec x_a, x_b;
+        a.getState(x_a);
+        b.getState(x_b);
+        a.setState(x_b);
+        b.setState(x_a);
+        e.accepted += 1;
+      }
+    }
+
+    void exchange(const size_t k, const uint64_t round) {
+      const bool is_lower = k % 2 == round % 2;
+      if((is_lower && k + 1 >= models_.size()) || (!is_lower && k == 0)) { return; }
+      Exchange& e = *exchanges_[is_lower ? k : k - 1];
+      std::unique_lock<std::mutex> lock(e.mutex);
+      if(is_lower) {
+        e.cv.wait(lock, [&]() { return e.ready == round || failed_.load(); });
+        if(e.ready == round) { swap_states(k); }
+        e.done = round;
+        e.cv.notify_all();
+      } else {
+        e.ready = round;
+        e.cv.notify_all();
+        e.cv.wait(lock, [&]() { return e.done == round || failed_.load(); });
+      }
+    }
+
+    void run(const size_t k, const int iterations, const int thin, const uint64_t first_round) {
+      MCModel& m = *models_[k];
+      for(int i = 1; i <= iterations; i++) {
+        // another replica threw, its partners won't show up for the next swap
+        if(failed_.load()) { return; }
+        m.step();
+        if(thin && k == 0 && i % thin == 0) { m.tally(); }
+        if(i % swap_interval_ == 0) { exchange(k, first_round + i / swap_interval_); }
+      }
+    }
+
+    // f(k) for every replica, each on its own thread
+    void run_all(std::function<void (const size_t)> f) {
+      std::vector<std::exception_ptr> errors(models_.size());
+      std::vector<std::thread> threads;
+      for(size_t k = 0; k < models_.size(); k++) {
+        threads.push_back(std::thread([this, &f, &errors, k]() {
+              try {
+                f(k);
+              } catch(...) {
+                errors[k] = std::current_exception();
+                // release anyone waiting on this replica
+                failed_.store(true);
+                for(auto e : exchanges_) {
+                  std::lock_guard<std::mutex> lock(e->mutex);
+                  e->cv.notify_all();
+                }
+              }
+            }));
+      }
+      for(auto& t : threads) { t.join(); }
+      for(auto e : errors) {
+        if(e) {
+          failed_.store(false);
+          std::rethrow_exception(e);
+        }
+      }
+    }
+
+    // the rounds are claimed before running, so they are never reused even if a
+    // replica throws: a ready or done left by an abandoned exchange can't match a later round
+    void run_swapping(const int iterations, const int thin) {
+      const uint64_t first_round = round_;
+      round_ += iterations / swap_interval_;
+      run_all([this, iterations, thin, first_round](const size_t k) { run(k, iterations, thin, first_round); });
+    }
+
+    void set_betas() {
+      for(size_t k = 0; k < models_.size(); k++) { models_[k]->setBeta(betas_[k]); }
+    }
+  public:
+    // temperatures (1/beta) start geometrically spaced from 1 to max_temperature
+    ParallelTempering(Builder build, const size_t replicas, const double max_temperature = 100, const int swap_interval = 10, const unsigned int seed = 5489):
+      swap_interval_(swap_interval), round_(0), failed_(false) {
+      if(replicas < 1 || swap_interval < 1 || max_temperature < 1) {
+        throw std::logic_error("ERROR: parallel tempering needs at least 1 replica, swap_interval >= 1 and max_temperature >= 1.");
+      }
+      for(size_t k = 0; k < replicas; k++) {
+        rngs_.push_back(arena_.create<RNG>(seed + k));
+        models_.push_back(arena_.create<MCModel>(*rngs_[k]));
+        build(*models_[k], k);
+        if(!models_[k]->state_complete()) {
+          throw std::logic_error("ERROR: parallel tempering swaps the flat state, so every parameter must be packable (no integer, Wishart or MVCAR nodes).");
+        }
+        betas_.push_back(replicas == 1 ? 1 : pow(max_temperature, -static_cast<double>(k) / (replicas - 1)));
+        if(k + 1 < replicas) { exchanges_.push_back(arena_.create<Exchange>()); }
+      }
+      set_betas();
+    }
+
+    size_t size() const { return models_.size(); }
+    MCModel& replica(const size_t k) { return *models_.at(k); }
+    const std::vector<double>& betas() const { return betas_; }
+
+    // share of accepted swaps between replica k and k+1 since the ladder was last adapted
+    // (0 if none were attempted)
+    arma::vec swap_acceptance() const {
+      arma::vec ans(exchanges_.size());
+      for(size_t k = 0; k < exchanges_.size(); k++) {
+        ans[k] = exchanges_[k]->attempts > 0 ? exchanges_[k]->accepted / exchanges_[k]->attempts : 0;
+      }
+      return ans;
+    }
+
+    // runs (with swaps) in segments, after each of which the gaps between
+    // temperatures are moved toward an even swap rate of target (Miasojedow,
+    // Moulines & Vihola 2013): log(T_k+1 - T_k) += gamma * (rate_k - target)
+    void adapt_ladder(const int iterations, const int segment = 1000, const double target = 0.234) {
+      for(int s = 0; s * segment < iterations; s++) {
+        run_swapping(std::min(segment, iterations - s * segment), 0);
+        const double gamma = pow(s + 1.0, -0.6);
+        double temperature = 1;
+        for(size_t k = 0; k < exchanges_.size(); k++) {
+          Exchange& e = *exchanges_[k];
+          const double gap = 1 / betas_[k + 1] - 1 / betas_[k];
+          if(e.attempts > 0) {
+            temperature += exp(log(gap) + gamma * (e.accepted / e.attempts - target));
+          } else {
+            temperature += gap;
+          }
+          betas_[k + 1] = 1 / temperature;
+          e.attempts = 0;
+          e.accepted = 0;
+        }
+        set_betas();
+      }
+    }
+
+    // scale tuning, without swaps (replicas tune at their own beta)
+    void tune(const int iterations, const int tuning_step) {
+      run_all([this, iterations, tuning_step](const size_t k) { models_[k]->tune(iterations, tuning_step); });
+    }
+
+    void tune_global(const int iterations, const int tuning_step) {
+      run_all([this, iterations, tuning_step](const size_t k) { models_[k]->tune_global(iterations, tuning_step); });
+    }
+
+    void burn(const int iterations) {
+      run_swapping(iterations, 0);
+    }
+
+    void sample(const int iterations, const int thin) {
+      run_swapping(iterations, thin);
+    }
+  };
+
+} // namespace cppbugs
@@ -0,0 +1,255 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/mcmc.math.hpp>
+#include <cppbugs/mcmc.utils.hpp>
+#include <cppbugs/mcmc.summary.stats.hpp>
+#include <cppbugs/mcmc.serialize.hpp>
+
+namespace cppbugs {
+
+  // merging t-digest (Dunning & Ertl) of a stream of doubles
+  // centroids are bounded by the k1 scale function, so memory is O(compression)
+  // and the tails (where intervals live) are resolved most finely
+  class TDigest {
+  private:
+    struct Centroid {
+      double mean, weight;
+      bool operator<(const Centroid& x) const { return mean < x.mean; }
+    };
+    double compression_, total_, min_, max_;
+    std::vector<Centroid> centroids_, buffer_;
+
+    // k1 scale function and its inverse
+    double k_of_q(const double q) const { return compression_ / (2 * arma::datum::pi) * std::asin(2 * q - 1); }
+    double q_of_k(const double k) const {
+      return k >= compression_ / 4 ? 1 : (1 + std::sin(2 * arma::datum::pi * k / compression_)) / 2;
+    }
+
+    void compress() {
+      if(buffer_.empty()) { return; }
+      buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+      std::sort(buffer_.begin(), buffer_.end());
+      double total(0);
+      for(auto& c : buffer_) { total += c.weight; }
+
+      centroids_.clear();
+      Centroid cur = buffer_[0];
+      double weight_so_far(0);
+      double weight_limit = total * q_of_k(k_of_q(0) + 1);
+      for(size_t i = 1; i < buffer_.size(); i++) {
+        const Centroid& c = buffer_[i];
+        if(weight_so_far + cur.weight + c.weight <= weight_limit) {
+          cur.weight += c.weight;
+          cur.mean += (c.mean - cur.mean) * c.weight / cur.weight;
+        } else {
+          weight_so_far += cur.weight;
+          centroids_.push_back(cur);
+          weight_limit = total * q_of_k(k_of_q(weight_so_far / total) + 1);
+          cur = c;
+        }
+      }
+      centroids_.push_back(cur);
+      buffer_.clear();
+      total_ = total;
+    }
+
+    static void put_centroids(BinaryWriter& out, const std::vector<Centroid>& cs) {
+      out.put(static_cast<uint64_t>(cs.size()));
+      for(auto& c : cs) {
+        out.put(c.mean);
+        out.put(c.weight);
+      }
+    }
+    static void get_centroids(BinaryReader& in, std::vector<Centroid>& cs) {
+      cs.resize(in.get_u64());
+      for(auto& c : cs) {
+        c.mean = in.get_double();
+        c.weight = in.get_double();
+      }
+    }
+  public:
+    TDigest(const double compression = 100): compression_(compression), total_(0), min_(std::numeric_limits<double>::infinity()), max_(-std::numeric_limits<double>::infinity()) {}
+
+    void add(const double x, const double weight = 1) {
+      if(std::isnan(x)) { return; }
+      Centroid c = { x, weight };
+      buffer_.push_back(c);
+      min_ = std::min(min_, x);
+      max_ = std::max(max_, x);
+      if(buffer_.size() >= compression_) { compress(); }
+    }
+
+    void merge(const TDigest& x) {
+      buffer_.insert(buffer_.end(), x.centroids_.begin(), x.centroids_.end());
+      buffer_.insert(buffer_.end(), x.buffer_.begin(), x.buffer_.end());
+      min_ = std::min(min_, x.min_);
+      max_ = std::max(max_, x.max_);
+      compress();
+    }
+
+    double quantile(const double q) {
+      if(q < 0 || q > 1) { throw std::logic_error("ERROR: quantile must be in [0,1]."); }
+      compress();
+      if(centroids_.empty()) { return std::numeric_limits<double>::quiet_NaN(); }
+
+      // centroid i is taken to sit at cumulative weight (sum of w before i) + w_i/2
+      // and the sample extremes at 0 and total_
+      const double index = q * total_;
+      const Centroid& first = centroids_.front();
+      if(index < first.weight / 2) {
+        return min_ + (first.mean - min_) * index / (first.weight / 2);
+      }
+      double weight_so_far = first.weight / 2;
+      for(size_t i = 0; i + 1 < centroids_.size(); i++) {
+        const double dw = (centroids_[i].weight + centroids_[i+1].weight) / 2;
+        if(weight_so_far + dw > index) {
+          const double t = (index - weight_so_far) / dw;
+          return centroids_[i].mean + t * (centroids_[i+1].mean - centroids_[i].mean);
+        }
+        weight_so_far += dw;
+      }
+      const Centroid& last = centroids_.back();
+      const double t = std::min((index - weight_so_far) / (last.weight / 2), 1.0);
+      return last.mean + t * (max_ - last.mean);
+    }
+
+    double size() const {
+      double ans(total_);
+      for(auto& c : buffer_) { ans += c.weight; }
+      return ans;
+    }
+
+    // whole state (the unmerged buffer too, so a restored digest compresses
+    // exactly as the original would have)
+    void save(BinaryWriter& out) const {
+      out.put(compression_);
+      out.put(total_);
+      out.put(min_);
+      out.put(max_);
+      put_centroids(out, centroids_);
+      put_centroids(out, buffer_);
+    }
+    void load(BinaryReader& in) {
+      compression_ = in.get_double();
+      total_ = in.get_double();
+      min_ = in.get_double();
+      max_ = in.get_double();
+      get_centroids(in, centroids_);
+      get_centroids(in, buffer_);
+    }
+  };
+
+  // per element t-digests of a tracked value, bounded memory and mergeable
+  //
+  //   QuantileSketch<vec>& b_q = m.track<QuantileSketch>(b);
+  //   b_q.quantile(0.025); b_q.quantile(0.975);
+  template<typename T, class Alloc = std::allocator<T> >
+  class QuantileSketch {
+  public:
+    typedef typename initValue<T>::ansT ansT;
+  private:
+    double compression_;
+    size_t n_;
+    ansT shape_;
+    std::vector<TDigest> digests_;
+  public:
+    QuantileSketch(const double compression = 100): compression_(compression), n_(0), shape_() {}
+
+    // accuracy / memory tradeoff (call before the first tally)
+    void set_compression(const double compression) {
+      if(n_ > 0) {
+        throw std::logic_error("ERROR: QuantileSketch compression must be set before the first tally.");
+      }
+      compression_ = compression;
+    }
+
+    void push_back(const T& x) {
+      const size_t k = dim_size(x);
+      if(n_ == 0) {
+        shape_ = initValue<T>::init(x);
+        digests_.assign(k, TDigest(compression_));
+      }
+      for(size_t i = 0; i < k; i++) {
+        digests_[i].add(element(x,i));
+      }
+      ++n_;
+    }
+
+    // combine with a sketch of the same value from another chain
+    void merge(const QuantileSketch& x) {
+      if(x.n_ == 0) { return; }
+      if(n_ == 0) { *this = x; return; }
+      if(x.digests_.size() != digests_.size()) {
+        throw std::logic_error("ERROR: cannot merge QuantileSketches of different shapes.");
+      }
+      for(size_t i = 0; i < digests_.size(); i++) {
+        digests_[i].merge(x.digests_[i]);
+      }
+      n_ += x.n_;
+    }
+
+    size_t size() const { return n_; }
+
+    ansT quantile(const double q) {
+      if(n_ == 0) { throw std::logic_error("ERROR: QuantileSketch has no observations."); }
+      std::vector<double> ans(digests_.size());
+      for(size_t i = 0; i < digests_.size(); i++) {
+        ans[i] = digests_[i].quantile(q);
+      }
+      ansT x(shape_);
+      unflatten(x, ans.data());
+      return x;
+    }
+
+    void save(BinaryWriter& out) const {
+      out.put(compression_);
+      out.put(static_cast<uint64_t>(n_));
+      if(n_ == 0) { return; }
+      out.put_value(shape_);
+      out.put(static_cast<uint64_t>(digests_.size()));
+      for(auto& d : digests_) { d.save(out); }
+    }
+    void load(BinaryReader& in) {
+      compression_ = in.get_double();
+      n_ = in.get_u64();
+      if(n_ == 0) { return; }
+      in.get_value(shape_);
+      digests_.resize(in.get_u64());
+      for(auto& d : digests_) { d.load(in); }
+    }
+  };
+
+  template<typename T, typename A>
+  bool can_checkpoint(const QuantileSketch<T,A>& x) { return true; }
+
+  template<typename T, typename A>
+  void put_history(BinaryWriter& out, BinaryWriter& log, const QuantileSketch<T,A>& x, size_t& logged) { x.save(out); }
+
+  template<typename T, typename A>
+  void get_history(BinaryReader& in, QuantileSketch<T,A>& x, size_t& logged) { x.load(in); }
+
+} // namespace cppbugs
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <string>
+#include <stdexcept>
 
 namespace cppbugs {
 
@@ -27,6 +29,10 @@ namespace cppbugs {
     virtual double uniform() = 0;
     //virtual int poisson(n) = 0;
     // etc...
+
+    // full generator state, for checkpoints
+    virtual std::string save() const { throw std::logic_error("ERROR: this rng can't be saved."); }
+    virtual void load(const std::string& state) { throw std::logic_error("ERROR: this rng can't be restored."); }
   };
 
 } // namespace cppbugs
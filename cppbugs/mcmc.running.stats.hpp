@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/mcmc.math.hpp>
+#include <cppbugs/mcmc.utils.hpp>
+#include <cppbugs/mcmc.summary.stats.hpp>
+#include <cppbugs/mcmc.serialize.hpp>
+
+namespace cppbugs {
+
+  // online (Welford) mean / variance, and optionally covariance, of a tracked
+  // value.  memory is O(size) (O(size^2) w/ covariance) regardless of run length
+  //
+  //   RunningStats<vec>& b_stats = m.track<RunningStats>(b);
+  //   b_stats.mean(); b_stats.sd();
+  template<typename T, class Alloc = std::allocator<T> >
+  class RunningStats {
+  public:
+    typedef typename initValue<T>::ansT ansT;
+  private:
+    double n_;
+    ansT shape_;
+    arma::vec mean_, m2_, delta_;
+    arma::mat comoment_;
+    bool covariance_;
+
+    ansT unflatten_vec(const arma::vec& x) const {
+      ansT ans(shape_);
+      unflatten(ans, x.memptr());
+      return ans;
+    }
+  public:
+    RunningStats(): n_(0), shape_(), covariance_(false) {}
+
+    // also accumulate the covariance between elements (call before the first tally)
+    void enable_covariance() {
+      if(n_ > 0) {
+        throw std::logic_error("ERROR: RunningStats covariance must be enabled before the first tally.");
+      }
+      covariance_ = true;
+    }
+
+    void push_back(const T& x) {
+      const size_t k = dim_size(x);
+      if(n_ == 0) {
+        shape_ = initValue<T>::init(x);
+        mean_.zeros(k);
+        m2_.zeros(k);
+        delta_.zeros(k);
+        if(covariance_) { comoment_.zeros(k,k); }
+      }
+      n_ += 1;
+      for(size_t i = 0; i < k; i++) {
+        const double x_i = element(x,i);
+        delta_[i] = x_i - mean_[i];
+        mean_[i] += delta_[i] / n_;
+        m2_[i] += delta_[i] * (x_i - mean_[i]);
+      }
+      if(covariance_) {
+        // C += (x - mean_old) (x - mean_new)'
+        for(size_t j = 0; j < k; j++) {
+          const double d_new = element(x,j) - mean_[j];
+          for(size_t i = 0; i < k; i++) {
+            comoment_.at(i,j) += delta_[i] * d_new;
+          }
+        }
+      }
+    }
+
+    // combine with stats accumulated elsewhere (i.e. another chain)
+    void merge(const RunningStats& x) {
+      if(x.n_ == 0) { return; }
+      if(n_ == 0) { *this = x; return; }
+      if(x.mean_.n_elem != mean_.n_elem || x.covariance_ != covariance_) {
+        throw std::logic_error("ERROR: cannot merge RunningStats of different shapes.");
+      }
+      const double n = n_ + x.n_;
+      const arma::vec d = x.mean_ - mean_;
+      if(covariance_) {
+        comoment_ += x.comoment_ + (n_ * x.n_ / n) * d * d.t();
+      }
+      m2_ += x.m2_ + (n_ * x.n_ / n) * arma::square(d);
+      mean_ += d * (x.n_ / n);
+      n_ = n;
+    }
+
+    size_t size() const { return n_; }
+    ansT mean() const { return unflatten_vec(mean_); }
+    ansT variance() const {
+      if(n_ < 2) { throw std::logic_error("variance: need more than 1 observation."); }
+      return unflatten_vec(m2_ / (n_ - 1));
+    }
+    ansT sd() const {
+      if(n_ < 2) { throw std::logic_error("sd: need more than 1 observation."); }
+      return unflatten_vec(arma::sqrt(m2_ / (n_ - 1)));
+    }
+    // covariance of the flattened (column major) elements
+    arma::mat covariance() const {
+      if(!covariance_) { throw std::logic_error("covariance: not enabled for these RunningStats."); }
+      if(n_ < 2) { throw std::logic_error("covariance: need more than 1 observation."); }
+      return comoment_ / (n_ - 1);
+    }
+
+    // whole state, for checkpoints
+    void save(BinaryWriter& out) const {
+      out.put(n_);
+      out.put(static_cast<uint64_t>(covariance_));
+      if(n_ == 0) { return; }
+      out.put_value(shape_);
+      out.put(mean_);
+      out.put(m2_);
+      if(covariance_) { out.put_value(comoment_); }
+    }
+    void load(BinaryReader& in) {
+      n_ = in.get_double();
+      covariance_ = in.get_u64() != 0;
+      if(n_ == 0) { return; }
+      in.get_value(shape_);
+      mean_ = in.get_vec();
+      m2_ = in.get_vec();
+      delta_.zeros(mean_.n_elem);
+      if(covariance_) { in.get_value(comoment_); }
+    }
+  };
+
+  template<typename T, typename A>
+  bool can_checkpoint(const RunningStats<T,A>& x) { return true; }
+
+  template<typename T, typename A>
+  void put_history(BinaryWriter& out, BinaryWriter& log, const RunningStats<T,A>& x, size_t& logged) { x.save(out); }
+
+  template<typename T, typename A>
+  void get_history(BinaryReader& in, RunningStats<T,A>& x, size_t& logged) { x.load(in); }
+
+} // namespace cppbugs
@@ -0,0 +1,283 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <armadillo>
+#include <cppbugs/mcmc.arena.hpp>
+#include <cppbugs/mcmc.model.hpp>
+#include <cppbugs/mcmc.thread.pool.hpp>
+
+namespace cppbugs {
+
+  // sequential monte carlo with adaptive tempering: N particles move from the
+  // prior (beta = 0) to the posterior (beta = 1) through prior * likelihood^beta.
+  // each step picks the largest increase in beta that keeps the effective sample
+  // size of the incremental weights at ess_fraction * N, resamples, then runs
+  // random walk metropolis moves with the particle covariance (scaled by
+  // 2.38 / sqrt(d)).  the product of the mean incremental weights is the
+  // marginal likelihood
+  //
+  // particles are stored by parameter (N x d, column major), so weights,
+  // means and covariances run over contiguous memory.  logp evaluations are
+  // spread over threads, each thread using the stochastic nodes' loglik on
+  // its own copy of the model; all draws are made on the calling thread, so
+  // results do not depend on the thread count
+  //
+  //   SequentialMonteCarlo<BoostRng<boost::mt19937> > smc([&](MCModel& m, const size_t t) {
+  //     ...
+  //     if(t == 0) { b_hist = &m.track<std::vector>(b); }
+  //   }, 1000, 4);
+  //   const double log_z = smc.run();   // tallies every final particle
+  //
+  // priors must be proper: the starting particles are spaced draws from model
+  // 0's metropolis chain at beta = 0
+  template<typename RNG>
+  class SequentialMonteCarlo {
+  public:
+    typedef std::function<void (MCModel&, const size_t)> Builder;
+  private:
+    MCArena arena_;
+    std::vector<RNG*> rngs_;
+    std::vector<MCModel*> models_;
+    ThreadPool pool_;
+    const double ess_fraction_;
+    const int moves_;
+    arma::mat particles_, proposals_;
+    arma::vec prior_, likelihood_, proposal_prior_, proposal_likelihood_;
+    double beta_, log_evidence_, accepted_, rejected_;
+    std::vector<double> betas_;
+
+    static bool bad(const double x) {
+      return std::isnan(x) || x == -std::numeric_limits<double>::infinity();
+    }
+
+    // prior and likelihood of every row of x, over the thread pool
+    void evaluate(const arma::mat& x, arma::vec& prior, arma::vec& likelihood) {
+      pool_.run([this, &x, &prior, &likelihood](const size_t t) {
+          arma::vec row(x.n_cols);
+          for(size_t i = t; i < x.n_rows; i += models_.size()) {
+            for(size_t j = 0; j < x.n_cols; j++) { row[j] = x(i, j); }
+            models_[t]->logp_parts_at(row, prior[i], likelihood[i]);
+            if(std::isnan(likelihood[i])) { likelihood[i] = -std::numeric_limits<double>::infinity(); }
+          }
+        });
+    }
+
+    // log of sum(exp(delta * likelihood)), and the normalised weights
+    double log_weights(const double delta, arma::vec& w) const {
+      double top = -std::numeric_limits<double>::infinity();
+      for(auto l : likelihood_) { top = std::max(top, delta * l); }
+      w.set_size(likelihood_.n_elem);
+      double sum(0);
+      for(size_t i = 0; i < w.n_elem; i++) {
+        w[i] = bad(likelihood_[i]) ? 0 : exp(delta * likelihood_[i] - top);
+        sum += w[i];
+      }
+      w /= sum;
+      return top + log(sum);
+    }
+
+    double ess(const double delta) const {
+      arma::vec w;
+      log_weights(delta, w);
+      return 1 / arma::accu(w % w);
+    }
+
+    double next_delta() const {
+      const double target = ess_fraction_ * particles_.n_rows;
+      double hi = 1 - beta_;
+      if(ess(hi) >= target) { return hi; }
+      double lo = 0;
+      for(int i = 0; i < 50; i++) {
+        const double mid = (lo + hi) / 2;
+        if(ess(mid) >= target) { lo = mid; } else { hi = mid; }
+      }
+      // never stall: a zero step would repeat forever
+      return std::max(lo, std::numeric_limits<double>::epsilon());
+    }
+
+    // systematic resampling
+    void resample(const arma::vec& w) {
+      const size_t n = particles_.n_rows;
+      std::vector<size_t> pick(n);
+      const double u = rngs_[0]->uniform() / n;
+      double cumulative = w[0];
+      size_t j = 0;
+      for(size_t i = 0; i < n; i++) {
+        const double point = u + static_cast<double>(i) / n;
+        while(point > cumulative && j + 1 < n) { cumulative += w[++j]; }
+        pick[i] = j;
+      }
+      arma::mat particles(particles_.n_rows, particles_.n_cols);
+      arma::vec prior(n), likelihood(n);
+      for(size_t c = 0; c < particles_.n_cols; c++) {
+        const double* from = particles_.colptr(c);
+        double* to = particles.colptr(c);
+        for(size_t i = 0; i < n; i++) { to[i] = from[pick[i]]; }
+      }
+      for(size_t i = 0; i < n; i++) {
+        prior[i] = prior_[pick[i]];
+        likelihood[i] = likelihood_[pick[i]];
+      }
+      particles_.swap(particles);
+      prior_.swap(prior);
+      likelihood_.swap(likelihood);
+    }
+
+    // proposal factor: upper cholesky factor of the particle covariance,
+    // falling back to the standard deviations when that is singular
+    arma::mat proposal_factor() const {
+      const size_t n = particles_.n_rows, d = particles_.n_cols;
+      arma::mat centered(n, d);
+      for(size_t c = 0; c < d; c++) {
+        const double* x = particles_.colptr(c);
+        double* y = centered.colptr(c);
+        double mu(0);
+        for(size_t i = 0; i < n; i++) { mu += x[i]; }
+        mu /= n;
+        for(size_t i = 0; i < n; i++) { y[i] = x[i] - mu; }
+      }
+      arma::mat cov = centered.t() * centered / (n - 1.0);
+      arma::mat R;
+      if(!arma::chol(R, cov)) {
+        R.zeros(d, d);
+        for(size_t c = 0; c < d; c++) { R(c, c) = sqrt(cov(c, c)) + 1e-10; }
+      }
+      return R * (2.38 / sqrt(static_cast<double>(d)));
+    }
+
+    void move() {
+      const size_t n = particles_.n_rows, d = particles_.n_cols;
+      const arma::mat R = proposal_factor();
+      RngBase& rng = *rngs_[0];
+      arma::vec z(d);
+      for(int m = 0; m < moves_; m++) {
+        for(size_t i = 0; i < n; i++) {
+          for(size_t j = 0; j < d; j++) { z[j] = rng.normal(); }
+          // x + R' z, R upper triangular
+          for(size_t c = 0; c < d; c++) {
+            double step(0);
+            for(size_t j = 0; j <= c; j++) { step += R(j, c) * z[j]; }
+            proposals_(i, c) = particles_(i, c) + step;
+          }
+        }
+        evaluate(proposals_, proposal_prior_, proposal_likelihood_);
+        for(size_t i = 0; i < n; i++) {
+          const double value = proposal_prior_[i] + beta_ * proposal_likelihood_[i];
+          if(!bad(value) && log(rng.uniform()) < value - (prior_[i] + beta_ * likelihood_[i])) {
+            for(size_t c = 0; c < d; c++) { particles_(i, c) = proposals_(i, c); }
+            prior_[i] = proposal_prior_[i];
+            likelihood_[i] = proposal_likelihood_[i];
+            accepted_ += 1;
+          } else {
+            rejected_ += 1;
+          }
+        }
+      }
+    }
+  public:
+    // model 0 is tuned at beta = 0 for prior_tune iterations, then the particles
+    // are taken init_spacing steps apart
+    SequentialMonteCarlo(Builder build, const size_t particles, const size_t threads = 1, const double ess_fraction = 0.5, const int moves = 5, const int prior_tune = 2000, const int init_spacing = 10, const unsigned int seed = 5489):
+      pool_(std::max<size_t>(threads, 1)), ess_fraction_(ess_fraction), moves_(moves), beta_(0), log_evidence_(0), accepted_(0), rejected_(0) {
+      if(particles < 2 || !(ess_fraction > 0 && ess_fraction < 1) || moves < 0) {
+        throw std::logic_error("ERROR: smc needs at least 2 particles, 0 < ess_fraction < 1 and moves >= 0.");
+      }
+      for(size_t t = 0; t < pool_.size(); t++) {
+        rngs_.push_back(arena_.create<RNG>(seed + t));
+        models_.push_back(arena_.create<MCModel>(*rngs_[t]));
+        build(*models_[t], t);
+        if(!models_[t]->state_complete()) {
+          throw std::logic_error("ERROR: smc moves the flat state, so every parameter must be packable (no integer, Wishart or MVCAR nodes).");
+        }
+      }
+      MCModel& m = *models_[0];
+      const size_t d = m.state_size();
+      for(auto p : models_) {
+        if(p->state_size() != d) { throw std::logic_error("ERROR: smc models differ in state size."); }
+      }
+      m.setBeta(0);
+      if(prior_tune > 0) { m.tune(prior_tune, std::min(prior_tune, 100)); }
+      particles_.set_size(particles, d);
+      arma::vec x;
+      for(size_t i = 0; i < particles; i++) {
+        for(int s = 0; s < init_spacing; s++) { m.step(); }
+        m.getState(x);
+        for(size_t c = 0; c < d; c++) { particles_(i, c) = x[c]; }
+      }
+      m.setBeta(1);
+      m.resetAcceptanceRatio();
+      prior_.set_size(particles);
+      likelihood_.set_size(particles);
+      proposals_.set_size(particles, d);
+      proposal_prior_.set_size(particles);
+      proposal_likelihood_.set_size(particles);
+      evaluate(particles_, prior_, likelihood_);
+      betas_.push_back(beta_);
+    }
+
+    size_t size() const { return particles_.n_rows; }
+    MCModel& model(const size_t t) { return *models_.at(t); }
+    // one row per particle
+    const arma::mat& particles() const { return particles_; }
+    double beta() const { return beta_; }
+    const std::vector<double>& betas() const { return betas_; }
+    double log_evidence() const { return log_evidence_; }
+
+    double acceptance_ratio() const {
+      return accepted_ / (accepted_ + rejected_);
+    }
+
+    // one tempering step; returns the new beta
+    double step() {
+      if(beta_ >= 1) { return beta_; }
+      const double delta = std::min(next_delta(), 1 - beta_);
+      arma::vec w;
+      log_evidence_ += log_weights(delta, w) - log(static_cast<double>(particles_.n_rows));
+      resample(w);
+      beta_ = delta >= 1 - beta_ ? 1 : beta_ + delta;
+      betas_.push_back(beta_);
+      move();
+      return beta_;
+    }
+
+    // temper all the way to the posterior, tally every particle and return the log marginal likelihood
+    double run() {
+      while(beta_ < 1) { step(); }
+      tally();
+      return log_evidence_;
+    }
+
+    void tally() {
+      MCModel& m = *models_[0];
+      arma::vec x(particles_.n_cols);
+      for(size_t i = 0; i < particles_.n_rows; i++) {
+        for(size_t c = 0; c < particles_.n_cols; c++) { x[c] = particles_(i, c); }
+        m.setState(x);
+        m.tally();
+      }
+    }
+  };
+
+} // namespace cppbugs
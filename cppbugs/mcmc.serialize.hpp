@@ -0,0 +1,344 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <unistd.h>
+#include <armadillo>
+
+// small native endian binary records (tuning state, checkpoints):
+//
+//   magic (8 chars), version, model key, then the record's own fields
+//
+// records are built in memory and written to a temporary which is renamed
+// into place, so a crash never leaves a half written file behind.  logs (the
+// draws behind a checkpoint) are only ever appended to, and a record says how
+// much of its log belongs to it
+namespace cppbugs {
+
+  // for append_file: don't cut the file back first
+  const uint64_t no_truncate = std::numeric_limits<uint64_t>::max();
+
+  // 64 bit FNV-1a, for keying files by model structure
+  inline uint64_t fnv1a(const void* p, const size_t n, uint64_t h = 14695981039346656037ULL) {
+    const unsigned char* c = static_cast<const unsigned char*>(p);
+    for(size_t i = 0; i < n; i++) {
+      h = (h ^ c[i]) * 1099511628211ULL;
+    }
+    return h;
+  }
+
+  inline void write_file(const std::string& path, const std::string& bytes) {
+    const std::string tmp(path + ".tmp");
+    std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+    out.close();
+    if(!out || std::rename(tmp.c_str(), path.c_str()) != 0) {
+      throw std::runtime_error("ERROR: could not write file: " + path);
+    }
+  }
+
+  // appends bytes to path, first cutting it back to truncate_to bytes (i.e. to
+  // drop whatever a crashed run logged after its last checkpoint)
+  inline void append_file(const std::string& path, const std::string& bytes, const uint64_t truncate_to = no_truncate) {
+    if(truncate_to != no_truncate) {
+      std::ofstream create(path.c_str(), std::ios::binary | std::ios::app);
+      create.close();
+      if(!create || ::truncate(path.c_str(), truncate_to) != 0) {
+        throw std::runtime_error("ERROR: could not truncate file: " + path);
+      }
+    }
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::app);
+    out.write(bytes.data(), bytes.size());
+    out.close();
+    if(!out) {
+      throw std::runtime_error("ERROR: could not append to file: " + path);
+    }
+  }
+
+  class BinaryWriter {
+  private:
+    std::string bytes_;
+
+    void raw(const void* p, const size_t n) { bytes_.append(static_cast<const char*>(p), n); }
+  public:
+    // no header, i.e. for a chunk of a log
+    BinaryWriter() {}
+    BinaryWriter(const char* magic, const uint64_t version, const uint64_t key) {
+      raw(magic, 8);
+      put(version);
+      put(key);
+    }
+
+    void put(const uint64_t x) { raw(&x, sizeof(x)); }
+    void put(const double x) { raw(&x, sizeof(x)); }
+    void put(const arma::vec& x) {
+      put(static_cast<uint64_t>(x.n_elem));
+      raw(x.memptr(), x.n_elem * sizeof(double));
+    }
+    void put(const std::string& x) {
+      put(static_cast<uint64_t>(x.size()));
+      raw(x.data(), x.size());
+    }
+
+    // model values keep their shape
+    void put_value(const double x) { put(x); }
+    void put_value(const int x) { put(static_cast<double>(x)); }
+    void put_value(const bool x) { put(static_cast<double>(x)); }
+    template<typename T>
+    void put_value(const T& x) {
+      put(static_cast<uint64_t>(x.n_rows));
+      put(static_cast<uint64_t>(x.n_cols));
+      for(size_t i = 0; i < x.n_elem; i++) { put(static_cast<double>(x[i])); }
+    }
+
+    const std::string& bytes() const { return bytes_; }
+    std::string& bytes() { return bytes_; }
+    void write(const std::string& path) const { write_file(path, bytes_); }
+  };
+
+  class BinaryReader {
+  private:
+    const std::string path_;
+    std::string bytes_;
+    size_t at_;
+    bool good_;
+    uint64_t version_, key_;
+
+    void raw(void* p, const size_t n) {
+      if(at_ + n > bytes_.size()) { throw std::runtime_error("ERROR: truncated file: " + path_); }
+      std::memcpy(p, bytes_.data() + at_, n);
+      at_ += n;
+    }
+  public:
+    BinaryReader(const std::string& path, const char* magic): path_(path), at_(0), good_(false), version_(0), key_(0) {
+      std::ifstream in(path.c_str(), std::ios::binary);
+      if(!in) { return; }
+      std::ostringstream s;
+      s << in.rdbuf();
+      bytes_ = s.str();
+      char m[8];
+      raw(m, 8);
+      if(!std::equal(m, m + 8, magic)) { throw std::runtime_error("ERROR: not a cppbugs file of the expected kind: " + path_); }
+      version_ = get_u64();
+      key_ = get_u64();
+      good_ = true;
+    }
+
+    // false if the file doesn't exist
+    bool good() const { return good_; }
+    // bytes read so far (the header included)
+    size_t tell() const { return at_; }
+    uint64_t version() const { return version_; }
+    uint64_t key() const { return key_; }
+
+    uint64_t get_u64() { uint64_t x; raw(&x, sizeof(x)); return x; }
+    double get_double() { double x; raw(&x, sizeof(x)); return x; }
+    arma::vec get_vec() {
+      arma::vec x(get_u64());
+      raw(x.memptr(), x.n_elem * sizeof(double));
+      return x;
+    }
+    std::string get_string() {
+      std::string x(get_u64(), '\0');
+      if(!x.empty()) { raw(&x[0], x.size()); }
+      return x;
+    }
+
+    void get_value(double& x) { x = get_double(); }
+    void get_value(int& x) { x = static_cast<int>(get_double()); }
+    void get_value(bool& x) { x = get_double() != 0; }
+    template<typename T>
+    void get_value(T& x) {
+      const uint64_t n_rows = get_u64(), n_cols = get_u64();
+      x.set_size(n_rows, n_cols);
+      for(size_t i = 0; i < x.n_elem; i++) { x[i] = static_cast<typename T::elem_type>(get_double()); }
+    }
+  };
+
+  // writes records on a background thread, latest record wins: a record
+  // submitted while another is still waiting replaces it.  appends are all
+  // written, in order, and before any record submitted after them
+  class BackgroundWriter {
+  private:
+    struct Append {
+      std::string path, bytes;
+      uint64_t truncate_to;
+    };
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable ready_, done_;
+    std::string path_, pending_;
+    std::vector<Append> appends_;
+    bool has_pending_, busy_, closing_;
+    std::exception_ptr error_;
+
+    void start() {
+      if(!writer_.joinable()) { writer_ = std::thread(&BackgroundWriter::run, this); }
+    }
+
+    void run() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while(true) {
+        ready_.wait(lock, [this]() { return has_pending_ || !appends_.empty() || closing_; });
+        if(!has_pending_ && appends_.empty()) { break; }
+        std::string bytes, path(path_);
+        std::vector<Append> appends;
+        const bool has_record = has_pending_;
+        bytes.swap(pending_);
+        appends.swap(appends_);
+        has_pending_ = false;
+        busy_ = true;
+        lock.unlock();
+        try {
+          for(auto& a : appends) { append_file(a.path, a.bytes, a.truncate_to); }
+          if(has_record) { write_file(path, bytes); }
+        } catch(...) {
+          lock.lock();
+          error_ = std::current_exception();
+          lock.unlock();
+        }
+        lock.lock();
+        busy_ = false;
+        done_.notify_all();
+      }
+    }
+
+    void rethrow() {
+      if(error_) {
+        std::exception_ptr e = error_;
+        error_ = std::exception_ptr();
+        std::rethrow_exception(e);
+      }
+    }
+  public:
+    BackgroundWriter(): has_pending_(false), busy_(false), closing_(false) {}
+    BackgroundWriter(const BackgroundWriter&) = delete;
+    BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+    ~BackgroundWriter() {
+      try { close(); } catch(...) {}
+    }
+
+    // takes the bytes (by swap), so the caller only pays for building them
+    void submit(const std::string& path, std::string& bytes) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      rethrow();
+      start();
+      path_ = path;
+      pending_.swap(bytes);
+      has_pending_ = true;
+      ready_.notify_one();
+    }
+
+    // takes the bytes (by swap) to append to path (see append_file)
+    void append(const std::string& path, std::string& bytes, const uint64_t truncate_to = no_truncate) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      rethrow();
+      start();
+      Append a;
+      a.path = path;
+      a.bytes.swap(bytes);
+      a.truncate_to = truncate_to;
+      appends_.push_back(std::move(a));
+      ready_.notify_one();
+    }
+
+    // wait until everything submitted is on disk
+    void flush() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this]() { return !has_pending_ && appends_.empty() && !busy_; });
+      rethrow();
+    }
+
+    void close() {
+      if(writer_.joinable()) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          closing_ = true;
+          ready_.notify_one();
+        }
+        writer_.join();
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      rethrow();
+    }
+  };
+
+  // tracked histories are checkpointed in two parts: the draws tallied since
+  // the previous checkpoint are appended to the checkpoint's log (so that a
+  // checkpoint costs O(new draws) rather than O(history)), and a record in the
+  // checkpoint itself says how many there are.  bounded trackers (RunningStats,
+  // QuantileSketch, ThinnedHistory) overload these to save their whole state
+  // into the record; any other container can't be checkpointed
+  template<typename C>
+  bool can_checkpoint(const C& history) { return false; }
+
+  template<typename C>
+  void put_history(BinaryWriter& out, BinaryWriter& log, const C& history, size_t& logged) {
+    throw std::logic_error("ERROR: this tracked container can't be checkpointed.");
+  }
+
+  template<typename C>
+  void replay_history(BinaryReader& log, C& history) {}
+
+  template<typename C>
+  void get_history(BinaryReader& in, C& history, size_t& logged) {
+    throw std::logic_error("ERROR: this tracked container can't be checkpointed.");
+  }
+
+  template<typename T, typename A>
+  bool can_checkpoint(const std::vector<T,A>& history) { return true; }
+
+  // a log chunk is the position of its first draw, the number of draws, then the draws
+  template<typename T, typename A>
+  void put_history(BinaryWriter& out, BinaryWriter& log, const std::vector<T,A>& history, size_t& logged) {
+    log.put(static_cast<uint64_t>(logged));
+    log.put(static_cast<uint64_t>(history.size() - logged));
+    for(size_t i = logged; i < history.size(); i++) { log.put_value(history[i]); }
+    logged = history.size();
+    out.put(static_cast<uint64_t>(logged));
+  }
+
+  template<typename T, typename A>
+  void replay_history(BinaryReader& log, std::vector<T,A>& history) {
+    const uint64_t from = log.get_u64(), n = log.get_u64();
+    if(from > history.size()) { throw std::runtime_error("ERROR: corrupt checkpoint log."); }
+    history.resize(from + n);
+    for(size_t i = from; i < history.size(); i++) { log.get_value(history[i]); }
+  }
+
+  template<typename T, typename A>
+  void get_history(BinaryReader& in, std::vector<T,A>& history, size_t& logged) {
+    logged = in.get_u64();
+    if(logged != history.size()) { throw std::runtime_error("ERROR: checkpoint log does not match the checkpoint."); }
+  }
+
+} // namespace cppbugs
@@ -23,34 +23,28 @@
 
 namespace cppbugs {
 
-  template<typename T, typename U, double LOGLIKFUN(const T&, const U&)>
+  template<typename T, typename U, double LOGLIKFUN(const T&, const U&), void ELEMFUN(arma::vec&, const T&, const U&) = no_logp_elements, void SUPPORTFUN(double*, double*, const size_t, const U&) = unbounded_support>
   class Stochastic1p : public DynamicStochastic<T> {
   private:
     const U& p1_;
-    const bool destory_p1_;
   public:
-    Stochastic1p(T& value, const U& p1): DynamicStochastic<T>(value), p1_(p1), destory_p1_(false) { dimension_check(value,p1); }
-    // special ctors to capture rvalues and convert to heap objects
-    Stochastic1p(T& value, const U&& p1): DynamicStochastic<T>(value), p1_(p1), destory_p1_(true) { dimension_check(value, p1_); }
-
-    ~Stochastic1p() {
-      if(destory_p1_) { delete &p1_; }
-    }
+    Stochastic1p(T& value, const U& p1): DynamicStochastic<T>(value), p1_(p1) { dimension_check(value,p1); }
+    // rvalue hyperparameters are captured in the MCModel arena (see MCModel::link)
+    Stochastic1p(T& value, const U&& p1) = delete;
     double loglik() const { return LOGLIKFUN(DynamicStochastic<T>::value,p1_); }
+    void loglik_elements(arma::vec& ans) const { ELEMFUN(ans,DynamicStochastic<T>::value,p1_); }
+    void support(double* lower, double* upper) const { SUPPORTFUN(lower,upper,DynamicStochastic<T>::packed_size(),p1_); }
   };
 
-  template<typename T, typename U, double LOGLIKFUN(const T&, const U&)>
+  template<typename T, typename U, double LOGLIKFUN(const T&, const U&), void ELEMFUN(arma::vec&, const T&, const U&) = no_logp_elements>
   class ObservedStochastic1p : public Observed<T> {
   private:
     const U& p1_;
-    const bool destory_p1_;
   public:
-    ObservedStochastic1p(const T& value, const U& p1): Observed<T>(value), p1_(p1), destory_p1_(false) { dimension_check(value,p1); }
-    ObservedStochastic1p(T& value, const U&& p1): Observed<T>(value), p1_(p1), destory_p1_(true) { dimension_check(value, p1_); }
-    ~ObservedStochastic1p() {
-      if(destory_p1_) { delete &p1_; }
-    }
+    ObservedStochastic1p(const T& value, const U& p1): Observed<T>(value), p1_(p1) { dimension_check(value,p1); }
+    ObservedStochastic1p(const T& value, const U&& p1) = delete;
     double loglik() const { return LOGLIKFUN(Observed<T>::value,p1_); }
+    void loglik_elements(arma::vec& ans) const { ELEMFUN(ans,Observed<T>::value,p1_); }
   };
 
 } // namespace cppbugs
@@ -23,44 +23,34 @@
 
 namespace cppbugs {
 
-  template<typename T, typename U, typename V, double LOGLIKFUN(const T&, const U&, const V&)>
+  template<typename T, typename U, typename V, double LOGLIKFUN(const T&, const U&, const V&), void ELEMFUN(arma::vec&, const T&, const U&, const V&) = no_logp_elements, void SUPPORTFUN(double*, double*, const size_t, const U&, const V&) = unbounded_support>
   class Stochastic2p : public DynamicStochastic<T> {
   private:
     const U& p1_;
     const V& p2_;
-    const bool destory_p1_, destory_p2_;
   public:
-    Stochastic2p(T& value, const U& p1, const V& p2): DynamicStochastic<T>(value), p1_(p1), p2_(p2), destory_p1_(false), destory_p2_(false) { dimension_check(value, p1_, p2_); }
-    // special ctors to capture rvalues and convert to heap objects
-    Stochastic2p(T& value, const U&& p1, const V& p2): DynamicStochastic<T>(value), p1_(*(new U(p1))), p2_(p2), destory_p1_(true), destory_p2_(false) { dimension_check(value, p1_, p2_); }
-    Stochastic2p(T& value, const U& p1, const V&& p2): DynamicStochastic<T>(value), p1_(p1), p2_(*(new V(p2))), destory_p1_(false), destory_p2_(true) { dimension_check(value, p1_, p2_); }
-    Stochastic2p(T& value, const U&& p1, const V&& p2): DynamicStochastic<T>(value),p1_(*(new U(p1))), p2_(*(new V(p2))), destory_p1_(true), destory_p2_(true)   { dimension_check(value, p1_, p2_); }
-
-    ~Stochastic2p() {
-      if(destory_p1_) { delete &p1_; }
-      if(destory_p2_) { delete &p2_; }
-    }
+    Stochastic2p(T& value, const U& p1, const V& p2): DynamicStochastic<T>(value), p1_(p1), p2_(p2) { dimension_check(value, p1_, p2_); }
+    // rvalue hyperparameters are captured in the MCModel arena (see MCModel::link)
+    Stochastic2p(T& value, const U&& p1, const V& p2) = delete;
+    Stochastic2p(T& value, const U& p1, const V&& p2) = delete;
+    Stochastic2p(T& value, const U&& p1, const V&& p2) = delete;
     double loglik() const { return LOGLIKFUN(DynamicStochastic<T>::value,p1_,p2_); }
+    void loglik_elements(arma::vec& ans) const { ELEMFUN(ans,DynamicStochastic<T>::value,p1_,p2_); }
+    void support(double* lower, double* upper) const { SUPPORTFUN(lower,upper,DynamicStochastic<T>::packed_size(),p1_,p2_); }
   };
 
-  template<typename T, typename U, typename V, double LOGLIKFUN(const T&, const U&, const V&)>
+  template<typename T, typename U, typename V, double LOGLIKFUN(const T&, const U&, const V&), void ELEMFUN(arma::vec&, const T&, const U&, const V&) = no_logp_elements>
   class ObservedStochastic2p : public Observed<T> {
   private:
     const U& p1_;
     const V& p2_;
-    const bool destory_p1_, destory_p2_;
   public:
-    ObservedStochastic2p(const T& value, const U& p1, const V& p2): Observed<T>(value), p1_(p1), p2_(p2), destory_p1_(false), destory_p2_(false) { dimension_check(value, p1_, p2_); }
-    // special ctors to capture rvalues and convert to heap objects
-    ObservedStochastic2p(const T& value, const U&& p1, const V& p2): Observed<T>(value), p1_(*(new U(p1))), p2_(p2), destory_p1_(true), destory_p2_(false) { dimension_check(value, p1_, p2_); }
-    ObservedStochastic2p(const T& value, const U& p1, const V&& p2): Observed<T>(value), p1_(p1), p2_(*(new V(p2))), destory_p1_(false), destory_p2_(true) { dimension_check(value, p1_, p2_); }
-    ObservedStochastic2p(const T& value, const U&& p1, const V&& p2): Observed<T>(value),p1_(*(new U(p1))), p2_(*(new V(p2))), destory_p1_(true), destory_p2_(true)   { dimension_check(value, p1_, p2_); }
-
-    ~ObservedStochastic2p() {
-      if(destory_p1_) { delete &p1_; }
-      if(destory_p2_) { delete &p2_; }
-    }
+    ObservedStochastic2p(const T& value, const U& p1, const V& p2): Observed<T>(value), p1_(p1), p2_(p2) { dimension_check(value, p1_, p2_); }
+    ObservedStochastic2p(const T& value, const U&& p1, const V& p2) = delete;
+    ObservedStochastic2p(const T& value, const U& p1, const V&& p2) = delete;
+    ObservedStochastic2p(const T& value, const U&& p1, const V&& p2) = delete;
     double loglik() const { return LOGLIKFUN(Observed<T>::value,p1_,p2_); }
+    void loglik_elements(arma::vec& ans) const { ELEMFUN(ans,Observed<T>::value,p1_,p2_); }
   };
 
 } // namespace cppbugs
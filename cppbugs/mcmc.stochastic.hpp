@@ -19,6 +19,8 @@
 
 #include <limits>
 #include <cmath>
+#include <stdexcept>
+#include <armadillo>
 
 namespace cppbugs {
 
@@ -27,6 +29,8 @@ namespace cppbugs {
     Stochastic() {}
     ~Stochastic() {}
     virtual double loglik() const = 0;
+    // add each element's log density into ans (see MCModel::independent)
+    virtual void loglik_elements(arma::vec& ans) const { throw std::logic_error("ERROR: node has no elementwise log density."); }
   };
 
 } // namespace cppbugs
@@ -17,8 +17,14 @@
 
 #pragma once
 
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <iterator>
 #include <exception>
 #include <armadillo>
+#include <cppbugs/mcmc.math.hpp>
+#include <cppbugs/mcmc.utils.hpp>
 
 namespace cppbugs {
 
@@ -79,6 +85,18 @@ namespace cppbugs {
     }
   };
 
+  // fill x (as shaped by initValue<>::init) from a run of doubles
+  inline void unflatten(double& x, const double* p) {
+    x = *p;
+  }
+
+  template<typename T>
+  void unflatten(T& x, const double* p) {
+    for(size_t i = 0; i < x.n_elem; i++) {
+      x[i] = p[i];
+    }
+  }
+
   template<typename T>
   typename initValue< typename std::iterator_traits<T>::value_type >::ansT mean(T beg, T end) {
     typedef typename initValue< typename std::iterator_traits<T>::value_type >::ansT ansT;
@@ -109,4 +127,157 @@ namespace cppbugs {
     return sqrt(sum_squares / n1 );
   }
 
+  // autocorrelation of x at lags 0..n-1 via a zero padded fft, O(n log n)
+  inline arma::vec autocorrelation(const arma::vec& x) {
+    const arma::uword n = x.n_elem;
+    arma::uword nfft = 1;
+    while(nfft < 2 * n) { nfft *= 2; }
+    arma::cx_vec f = arma::fft(arma::vec(x - arma::mean(x)), nfft);
+    for(arma::uword i = 0; i < nfft; i++) {
+      f[i] = std::norm(f[i]);
+    }
+    const arma::vec acov = arma::real(arma::ifft(f));
+    arma::vec ans(n);
+    for(arma::uword i = 0; i < n; i++) {
+      ans[i] = acov[0] > 0 ? acov[i] / acov[0] : 0;
+    }
+    return ans;
+  }
+
+  namespace detail {
+
+    // one column per chain, one row per draw (draws truncated to the shortest chain)
+    // ess uses Geyer's initial monotone sequence on the multichain
+    // autocorrelation (as in Stan); rhat is the plain Gelman-Rubin ratio
+    inline double ess(const arma::mat& x) {
+      const arma::uword n = x.n_rows, m = x.n_cols;
+      if(n < 4) { throw std::logic_error("ERROR: ess needs at least 4 draws per chain."); }
+      arma::mat acov(n, m);
+      arma::vec chain_mean(m), chain_var(m);
+      for(arma::uword j = 0; j < m; j++) {
+        const arma::vec x_j = x.col(j);
+        chain_mean[j] = arma::mean(x_j);
+        chain_var[j] = arma::var(x_j);
+        acov.col(j) = autocorrelation(x_j) * (chain_var[j] * (n - 1) / n);
+      }
+      const double W = arma::mean(chain_var);
+      const double B_n = m > 1 ? arma::var(chain_mean) : 0;
+      const double var_plus = W * (n - 1) / n + B_n;
+      if(!(var_plus > 0)) { return static_cast<double>(n * m); }
+
+      // combined autocorrelations, normalised so that rho_0 = 1
+      const arma::vec acov_mean = arma::mean(acov, 1);
+      arma::vec rho(n);
+      rho[0] = 1;
+      for(arma::uword t = 1; t < n; t++) {
+        rho[t] = 1 - (W - acov_mean[t]) / var_plus;
+      }
+      // Geyer's initial positive sequence of pairs rho_2k + rho_2k+1, made monotone
+      double tau = -1, last_pair = 2;
+      for(arma::uword t = 0; t + 1 < n; t += 2) {
+        double pair = rho[t] + rho[t + 1];
+        if(pair <= 0) { break; }
+        pair = std::min(pair, last_pair);
+        tau += 2 * pair;
+        last_pair = pair;
+      }
+      // cap at n*m*log10(n*m) as the estimate is unstable for antithetic chains
+      const double nm = static_cast<double>(n * m);
+      return std::min(nm / std::max(tau, 1 / std::log10(nm)), nm * std::log10(nm));
+    }
+
+    inline double rhat(const arma::mat& x) {
+      const arma::uword n = x.n_rows, m = x.n_cols;
+      if(n < 2 || m < 2) { throw std::logic_error("ERROR: rhat needs at least 2 chains of 2 draws."); }
+      arma::vec chain_mean(m), chain_var(m);
+      for(arma::uword j = 0; j < m; j++) {
+        const arma::vec x_j = x.col(j);
+        chain_mean[j] = arma::mean(x_j);
+        chain_var[j] = arma::var(x_j);
+      }
+      const double W = arma::mean(chain_var);
+      const double B_n = arma::var(chain_mean);
+      if(!(W > 0)) { return B_n > 0 ? arma::datum::inf : 1; }
+      return std::sqrt(((n - 1.0) / n * W + B_n) / W);
+    }
+
+    // draws[e] holds element e of every draw, one column per chain
+    template<typename C>
+    std::vector<arma::mat> by_element(const std::vector<C>& chains, const bool split) {
+      if(chains.empty()) { throw std::logic_error("ERROR: no chains."); }
+      size_t n = std::distance(chains[0].begin(), chains[0].end());
+      for(auto& c : chains) { n = std::min<size_t>(n, std::distance(c.begin(), c.end())); }
+      if(n == 0) { throw std::logic_error("ERROR: no observations."); }
+      const size_t k = dim_size(*chains[0].begin());
+      const size_t rows = split ? n / 2 : n, parts = split ? 2 : 1;
+      std::vector<arma::mat> draws(k, arma::mat(rows, chains.size() * parts));
+      for(size_t j = 0; j < chains.size(); j++) {
+        auto it = chains[j].begin();
+        // an odd middle draw is dropped when splitting
+        for(size_t i = 0; i < n; i++, ++it) {
+          if(split && n % 2 && i == rows) { continue; }
+          const size_t part = i < rows ? 0 : 1, row = i < rows ? i : i - (n - rows);
+          for(size_t e = 0; e < k; e++) {
+            draws[e](row, j * parts + part) = element(*it, e);
+          }
+        }
+      }
+      return draws;
+    }
+
+    template<typename C, typename F>
+    typename initValue<typename C::value_type>::ansT by_element_apply(const std::vector<C>& chains, const bool split, F f) {
+      typedef typename initValue<typename C::value_type>::ansT ansT;
+      const std::vector<arma::mat> draws = by_element(chains, split);
+      std::vector<double> ans(draws.size());
+      for(size_t e = 0; e < draws.size(); e++) {
+        ans[e] = f(draws[e]);
+      }
+      ansT x(initValue<typename C::value_type>::init(*chains[0].begin()));
+      unflatten(x, ans.data());
+      return x;
+    }
+
+    template<typename T>
+    std::vector<std::vector<typename std::iterator_traits<T>::value_type> > one_chain(T beg, T end) {
+      return std::vector<std::vector<typename std::iterator_traits<T>::value_type> >(1, std::vector<typename std::iterator_traits<T>::value_type>(beg, end));
+    }
+  } // namespace detail
+
+  // effective sample size, per element, of one or more chains
+  // (each chain is any container w/ begin/end, i.e. a tracked history)
+  template<typename C>
+  typename initValue<typename C::value_type>::ansT ess(const std::vector<C>& chains) {
+    return detail::by_element_apply(chains, false, [](const arma::mat& x) { return detail::ess(x); });
+  }
+
+  template<typename T>
+  typename initValue< typename std::iterator_traits<T>::value_type >::ansT ess(T beg, T end) {
+    return ess(detail::one_chain(beg, end));
+  }
+
+  // split R-hat: every chain is cut in half so that within chain drift also shows
+  template<typename C>
+  typename initValue<typename C::value_type>::ansT rhat(const std::vector<C>& chains) {
+    return detail::by_element_apply(chains, true, [](const arma::mat& x) { return detail::rhat(x); });
+  }
+
+  template<typename T>
+  typename initValue< typename std::iterator_traits<T>::value_type >::ansT rhat(T beg, T end) {
+    return rhat(detail::one_chain(beg, end));
+  }
+
+  // Monte Carlo standard error of the posterior mean: sd / sqrt(ess)
+  template<typename C>
+  typename initValue<typename C::value_type>::ansT mcse(const std::vector<C>& chains) {
+    return detail::by_element_apply(chains, false, [](const arma::mat& x) {
+        return std::sqrt(arma::var(arma::vectorise(x)) / detail::ess(x));
+      });
+  }
+
+  template<typename T>
+  typename initValue< typename std::iterator_traits<T>::value_type >::ansT mcse(T beg, T end) {
+    return mcse(detail::one_chain(beg, end));
+  }
+
 } // namespace cppbugs
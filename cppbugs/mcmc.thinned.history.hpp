@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+#include <cppbugs/mcmc.serialize.hpp>
+
+namespace cppbugs {
+
+  // fixed memory trace for runs whose length isn't known up front
+  // keeps every thin'th draw; when full, every other stored draw is dropped
+  // and thin is doubled, so the history always holds between K/2 and K
+  // evenly spaced draws
+  //
+  //   ThinnedHistory<vec>& b_hist = m.track<ThinnedHistory>(b);
+  //   b_hist.set_capacity(2000);
+  template<typename T, class Alloc = std::allocator<T> >
+  class ThinnedHistory {
+  private:
+    std::vector<T,Alloc> draws_;
+    size_t capacity_, thin_, count_;
+
+    void compact() {
+      const size_t n = (draws_.size() + 1) / 2;
+      for(size_t i = 1; i < n; i++) {
+        draws_[i] = std::move(draws_[2 * i]);
+      }
+      draws_.erase(draws_.begin() + n, draws_.end());
+      thin_ *= 2;
+    }
+  public:
+    typedef typename std::vector<T,Alloc>::const_iterator const_iterator;
+    typedef const_iterator iterator;
+    typedef T value_type;
+
+    ThinnedHistory(const size_t capacity = 1000): capacity_(capacity), thin_(1), count_(0) {
+      if(capacity_ < 2) { throw std::logic_error("ERROR: ThinnedHistory capacity must be at least 2."); }
+      draws_.reserve(capacity_);
+    }
+
+    // memory cap in draws (call before the first tally)
+    void set_capacity(const size_t capacity) {
+      if(count_ > 0) { throw std::logic_error("ERROR: ThinnedHistory capacity must be set before the first tally."); }
+      if(capacity < 2) { throw std::logic_error("ERROR: ThinnedHistory capacity must be at least 2."); }
+      capacity_ = capacity;
+      draws_.reserve(capacity_);
+    }
+
+    void push_back(const T& x) {
+      const size_t i = count_++;
+      if(i % thin_) { return; }
+      if(draws_.size() == capacity_) {
+        compact();
+        if(i % thin_) { return; }
+      }
+      draws_.push_back(x);
+    }
+
+    // current spacing between stored draws, in tallies
+    size_t thin() const { return thin_; }
+    // total number of tallies seen
+    size_t count() const { return count_; }
+    size_t capacity() const { return capacity_; }
+
+    size_t size() const { return draws_.size(); }
+    bool empty() const { return draws_.empty(); }
+    const T& operator[](const size_t i) const { return draws_[i]; }
+    const_iterator begin() const { return draws_.begin(); }
+    const_iterator end() const { return draws_.end(); }
+
+    // whole state, bounded by the capacity
+    void save(BinaryWriter& out) const {
+      out.put(static_cast<uint64_t>(capacity_));
+      out.put(static_cast<uint64_t>(thin_));
+      out.put(static_cast<uint64_t>(count_));
+      out.put(static_cast<uint64_t>(draws_.size()));
+      for(auto& x : draws_) { out.put_value(x); }
+    }
+    void load(BinaryReader& in) {
+      capacity_ = in.get_u64();
+      thin_ = in.get_u64();
+      count_ = in.get_u64();
+      draws_.resize(in.get_u64());
+      draws_.reserve(capacity_);
+      for(auto& x : draws_) { in.get_value(x); }
+    }
+  };
+
+  template<typename T, typename A>
+  bool can_checkpoint(const ThinnedHistory<T,A>& x) { return true; }
+
+  template<typename T, typename A>
+  void put_history(BinaryWriter& out, BinaryWriter& log, const ThinnedHistory<T,A>& x, size_t& logged) { x.save(out); }
+
+  template<typename T, typename A>
+  void get_history(BinaryReader& in, ThinnedHistory<T,A>& x, size_t& logged) { x.load(in); }
+
+} // namespace cppbugs
@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace cppbugs {
+
+  // fixed set of workers that repeatedly run the same kind of job:
+  // run(f) calls f(0) .. f(n-1), f(0) on the calling thread and the rest on
+  // the workers, and returns once all of them have finished.  meant for many
+  // short parallel sections, where starting threads each time would dominate
+  class ThreadPool {
+  private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_, done_;
+    std::function<void (const size_t)> job_;
+    std::exception_ptr error_;
+    uint64_t generation_;
+    size_t pending_;
+    bool stop_;
+
+    void work(const size_t t) {
+      uint64_t seen = 0;
+      for(;;) {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          start_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+          if(stop_) { return; }
+          seen = generation_;
+        }
+        std::exception_ptr error;
+        try {
+          job_(t);
+        } catch(...) {
+          error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(error && !error_) { error_ = error; }
+        if(--pending_ == 0) { done_.notify_one(); }
+      }
+    }
+  public:
+    ThreadPool(const size_t n): generation_(0), pending_(0), stop_(false) {
+      for(size_t t = 1; t < n; t++) {
+        workers_.push_back(std::thread(&ThreadPool::work, this, t));
+      }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      start_.notify_all();
+      for(auto& w : workers_) { w.join(); }
+    }
+
+    size_t size() const { return workers_.size() + 1; }
+
+    void run(std::function<void (const size_t)> f) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = f;
+        error_ = nullptr;
+        pending_ = workers_.size();
+        ++generation_;
+      }
+      start_.notify_all();
+      std::exception_ptr error;
+      try {
+        f(0);
+      } catch(...) {
+        error = std::current_exception();
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [&]() { return pending_ == 0; });
+      if(!error) { error = error_; }
+      if(error) { std::rethrow_exception(error); }
+    }
+  };
+
+} // namespace cppbugs
@@ -0,0 +1,370 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <armadillo>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cppbugs/mcmc.tracked.hpp>
+#include <cppbugs/mcmc.utils.hpp>
+
+// append only binary trace, native endian:
+//
+//   header  magic "CPPBUGST", version, n_draws, header_bytes, width, n_fields,
+//           then per field: n_rows, n_cols, offset (in doubles), name length, name
+//           (padded to 8 bytes), the whole header padded to a multiple of 64 bytes
+//   rows    n_draws rows of width doubles, one per tally
+//
+// n_draws is only bumped (atomically) once a row is complete, so a reader may
+// map the file while sampling is still running and see a consistent prefix
+namespace cppbugs {
+
+  namespace trace_file {
+    static const char magic[8] = {'C','P','P','B','U','G','S','T'};
+    static const uint64_t version = 1;
+    // byte offsets of the fixed header fields
+    static const size_t version_at = 8, n_draws_at = 16, header_bytes_at = 24, width_at = 32, n_fields_at = 40, fields_at = 48;
+
+    inline size_t padded(const size_t n, const size_t to) { return (n + to - 1) / to * to; }
+
+    inline uint64_t load(const char* base, const size_t at) {
+      return __atomic_load_n(reinterpret_cast<const uint64_t*>(base + at), __ATOMIC_ACQUIRE);
+    }
+    inline void store(char* base, const size_t at, const uint64_t x) {
+      __atomic_store_n(reinterpret_cast<uint64_t*>(base + at), x, __ATOMIC_RELEASE);
+    }
+  } // namespace trace_file
+
+  inline void trace_shape(const double& x, uint64_t& n_rows, uint64_t& n_cols) { n_rows = 1; n_cols = 1; }
+  inline void trace_shape(const int& x, uint64_t& n_rows, uint64_t& n_cols) { n_rows = 1; n_cols = 1; }
+  inline void trace_shape(const bool& x, uint64_t& n_rows, uint64_t& n_cols) { n_rows = 1; n_cols = 1; }
+
+  template<typename T>
+  void trace_shape(const T& x, uint64_t& n_rows, uint64_t& n_cols) { n_rows = x.n_rows; n_cols = x.n_cols; }
+
+  // writer: rows are written straight into a shared mapping of the file
+  //
+  //   TraceFile trace("herd.trace");
+  //   trace.add("b", b).add("overdisp", overdisp);
+  //   m.track(trace);
+  class TraceFile : public MCMCTracked {
+  private:
+    struct Field {
+      std::string name;
+      uint64_t n_rows, n_cols, offset;
+      std::function<void(double*)> copy;
+    };
+    const std::string path_;
+    std::vector<Field> fields_;
+    uint64_t width_, header_bytes_, n_draws_, capacity_;
+    int fd_;
+    char* map_;
+    size_t map_bytes_;
+    bool closed_;
+
+    size_t file_bytes(const uint64_t rows) const { return header_bytes_ + rows * width_ * sizeof(double); }
+
+    void map(const uint64_t rows) {
+      if(map_) { munmap(map_, map_bytes_); map_ = NULL; }
+      map_bytes_ = file_bytes(rows);
+      if(ftruncate(fd_, map_bytes_) != 0) {
+        throw std::runtime_error("ERROR: could not grow trace file: " + path_);
+      }
+      void* p = mmap(NULL, map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+      if(p == MAP_FAILED) {
+        throw std::runtime_error("ERROR: could not map trace file: " + path_);
+      }
+      map_ = static_cast<char*>(p);
+      capacity_ = rows;
+    }
+
+    void start() {
+      fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if(fd_ < 0) {
+        throw std::runtime_error("ERROR: could not open trace file: " + path_);
+      }
+      size_t bytes = trace_file::fields_at;
+      for(auto& f : fields_) {
+        bytes += 4 * sizeof(uint64_t) + trace_file::padded(f.name.size(), 8);
+      }
+      header_bytes_ = trace_file::padded(bytes, 64);
+      map(capacity_);
+
+      std::memset(map_, 0, header_bytes_);
+      std::memcpy(map_, trace_file::magic, sizeof(trace_file::magic));
+      char* p = map_ + trace_file::version_at;
+      const uint64_t fixed[] = { trace_file::version, 0, header_bytes_, width_, fields_.size() };
+      std::memcpy(p, fixed, sizeof(fixed));
+      p = map_ + trace_file::fields_at;
+      for(auto& f : fields_) {
+        const uint64_t desc[] = { f.n_rows, f.n_cols, f.offset, f.name.size() };
+        std::memcpy(p, desc, sizeof(desc));
+        p += sizeof(desc);
+        std::memcpy(p, f.name.data(), f.name.size());
+        p += trace_file::padded(f.name.size(), 8);
+      }
+    }
+  public:
+    TraceFile(const std::string& path, const uint64_t initial_rows = 1024):
+      path_(path), width_(0), header_bytes_(0), n_draws_(0), capacity_(std::max<uint64_t>(initial_rows,1)), fd_(-1), map_(NULL), map_bytes_(0), closed_(false) {}
+    TraceFile(const TraceFile&) = delete;
+    TraceFile& operator=(const TraceFile&) = delete;
+    ~TraceFile() {
+      try { close(); } catch(...) {}
+    }
+
+    template<typename T>
+    TraceFile& add(const std::string& name, const T& x) {
+      if(fd_ >= 0 || closed_) {
+        throw std::logic_error("ERROR: cannot add to a TraceFile after tracking has started.");
+      }
+      Field f;
+      f.name = name;
+      trace_shape(x, f.n_rows, f.n_cols);
+      f.offset = width_;
+      f.copy = [&x](double* out) { flat_copy(x, out); };
+      width_ += f.n_rows * f.n_cols;
+      fields_.push_back(f);
+      return *this;
+    }
+
+    uint64_t size() const { return n_draws_; }
+
+    void track() {
+      // reopening would truncate the draws already written
+      if(closed_) {
+        throw std::logic_error("ERROR: cannot track to a TraceFile after it has been closed.");
+      }
+      if(fd_ < 0) { start(); }
+      // grow geometrically, the file is remapped rather than copied
+      if(n_draws_ == capacity_) { map(2 * capacity_); }
+      double* row = reinterpret_cast<double*>(map_ + header_bytes_) + n_draws_ * width_;
+      for(auto& f : fields_) {
+        f.copy(row + f.offset);
+      }
+      trace_file::store(map_, trace_file::n_draws_at, ++n_draws_);
+    }
+
+    // trim the file to the rows actually written
+    void close() {
+      if(fd_ < 0) { return; }
+      closed_ = true;
+      munmap(map_, map_bytes_);
+      map_ = NULL;
+      const int ans = ftruncate(fd_, file_bytes(n_draws_));
+      ::close(fd_);
+      fd_ = -1;
+      if(ans != 0) {
+        throw std::runtime_error("ERROR: could not trim trace file: " + path_);
+      }
+    }
+  };
+
+  // strided view of one field across draws, dereferences to double, arma::vec
+  // or arma::mat (the latter two being views on the mapped rows, i.e. no copy)
+  template<typename T>
+  struct trace_value;
+
+  template<>
+  struct trace_value<double> {
+    static double get(const double* p, const uint64_t n_rows, const uint64_t n_cols) { return *p; }
+  };
+
+  template<>
+  struct trace_value<arma::vec> {
+    static arma::vec get(const double* p, const uint64_t n_rows, const uint64_t n_cols) { return arma::vec(const_cast<double*>(p), n_rows * n_cols, false, true); }
+  };
+
+  template<>
+  struct trace_value<arma::mat> {
+    static arma::mat get(const double* p, const uint64_t n_rows, const uint64_t n_cols) { return arma::mat(const_cast<double*>(p), n_rows, n_cols, false, true); }
+  };
+
+  template<typename T>
+  class TraceIterator {
+    const double* p_;
+    uint64_t stride_, n_rows_, n_cols_;
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef T reference;
+
+    TraceIterator(const double* p, const uint64_t stride, const uint64_t n_rows, const uint64_t n_cols): p_(p), stride_(stride), n_rows_(n_rows), n_cols_(n_cols) {}
+    T operator*() const { return trace_value<T>::get(p_, n_rows_, n_cols_); }
+    T operator[](const difference_type n) const { return *(*this + n); }
+    TraceIterator& operator++() { p_ += stride_; return *this; }
+    TraceIterator operator++(int) { TraceIterator ans(*this); p_ += stride_; return ans; }
+    TraceIterator& operator--() { p_ -= stride_; return *this; }
+    TraceIterator& operator+=(const difference_type n) { p_ += n * static_cast<difference_type>(stride_); return *this; }
+    TraceIterator operator+(const difference_type n) const { TraceIterator ans(*this); return ans += n; }
+    difference_type operator-(const TraceIterator& x) const { return (p_ - x.p_) / static_cast<difference_type>(stride_); }
+    bool operator==(const TraceIterator& x) const { return p_ == x.p_; }
+    bool operator!=(const TraceIterator& x) const { return p_ != x.p_; }
+    bool operator<(const TraceIterator& x) const { return p_ < x.p_; }
+  };
+
+  template<typename T>
+  class TraceRange {
+    TraceIterator<T> beg_, end_;
+  public:
+    TraceRange(const TraceIterator<T>& beg, const TraceIterator<T>& end): beg_(beg), end_(end) {}
+    TraceIterator<T> begin() const { return beg_; }
+    TraceIterator<T> end() const { return end_; }
+    size_t size() const { return end_ - beg_; }
+  };
+
+  // reader: maps the file read only, works on a file that is still being written
+  //
+  //   TraceFileReader trace("herd.trace");
+  //   TraceRange<arma::vec> b = trace.field<arma::vec>("b");
+  //   mean(b.begin(), b.end());
+  class TraceFileReader {
+  private:
+    struct Field {
+      std::string name;
+      uint64_t n_rows, n_cols, offset;
+    };
+    const std::string path_;
+    std::vector<Field> fields_;
+    uint64_t width_, header_bytes_;
+    int fd_;
+    const char* map_;
+    size_t map_bytes_;
+
+    void map() {
+      if(map_) { munmap(const_cast<char*>(map_), map_bytes_); map_ = NULL; }
+      struct stat st;
+      if(fstat(fd_, &st) != 0 || st.st_size < static_cast<off_t>(trace_file::fields_at)) {
+        throw std::runtime_error("ERROR: not a trace file: " + path_);
+      }
+      map_bytes_ = st.st_size;
+      void* p = mmap(NULL, map_bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+      if(p == MAP_FAILED) {
+        throw std::runtime_error("ERROR: could not map trace file: " + path_);
+      }
+      map_ = static_cast<const char*>(p);
+    }
+
+    const Field& find(const std::string& name) const {
+      for(auto& f : fields_) {
+        if(f.name == name) { return f; }
+      }
+      throw std::logic_error("ERROR: no field named " + name + " in trace file: " + path_);
+    }
+  public:
+    void corrupt() const { throw std::runtime_error("ERROR: corrupt trace file: " + path_); }
+
+    // nothing in the header is trusted: every field must lie inside a row and
+    // the header inside the mapping, so that size() rows are always readable
+    void read_header() {
+      if(std::memcmp(map_, trace_file::magic, sizeof(trace_file::magic)) != 0 || trace_file::load(map_, trace_file::version_at) != trace_file::version) {
+        throw std::runtime_error("ERROR: not a trace file: " + path_);
+      }
+      header_bytes_ = trace_file::load(map_, trace_file::header_bytes_at);
+      width_ = trace_file::load(map_, trace_file::width_at);
+      const uint64_t n_fields = trace_file::load(map_, trace_file::n_fields_at);
+      if(header_bytes_ < trace_file::fields_at || header_bytes_ > map_bytes_ || header_bytes_ % sizeof(double) != 0 ||
+         width_ > (std::numeric_limits<uint64_t>::max() / sizeof(double))) {
+        corrupt();
+      }
+      const char* p = map_ + trace_file::fields_at;
+      const char* end = map_ + header_bytes_;
+      for(uint64_t i = 0; i < n_fields; i++) {
+        uint64_t desc[4];
+        if(static_cast<size_t>(end - p) < sizeof(desc)) { corrupt(); }
+        std::memcpy(desc, p, sizeof(desc));
+        p += sizeof(desc);
+        Field f;
+        f.n_rows = desc[0];
+        f.n_cols = desc[1];
+        f.offset = desc[2];
+        if(desc[3] > static_cast<size_t>(end - p) ||
+           (f.n_cols && f.n_rows > width_ / f.n_cols) || f.offset > width_ - f.n_rows * f.n_cols) {
+          corrupt();
+        }
+        f.name.assign(p, desc[3]);
+        p += std::min<uint64_t>(trace_file::padded(desc[3], 8), end - p);
+        fields_.push_back(f);
+      }
+    }
+  public:
+    TraceFileReader(const std::string& path): path_(path), fd_(-1), map_(NULL), map_bytes_(0) {
+      fd_ = ::open(path_.c_str(), O_RDONLY);
+      if(fd_ < 0) {
+        throw std::runtime_error("ERROR: could not open trace file: " + path_);
+      }
+      // the destructor won't run if this throws
+      try {
+        map();
+        read_header();
+      } catch(...) {
+        if(map_) { munmap(const_cast<char*>(map_), map_bytes_); }
+        ::close(fd_);
+        throw;
+      }
+    }
+    TraceFileReader(const TraceFileReader&) = delete;
+    TraceFileReader& operator=(const TraceFileReader&) = delete;
+    ~TraceFileReader() {
+      if(map_) { munmap(const_cast<char*>(map_), map_bytes_); }
+      if(fd_ >= 0) { ::close(fd_); }
+    }
+
+    // complete draws visible in the current mapping: n_draws is capped by the
+    // rows that fit, so a header claiming more than the file holds is never read past
+    uint64_t size() const {
+      const uint64_t mapped = width_ ? (map_bytes_ - header_bytes_) / (width_ * sizeof(double)) : 0;
+      return std::min(trace_file::load(map_, trace_file::n_draws_at), mapped);
+    }
+
+    // pick up draws appended since the file was opened (invalidates ranges)
+    void refresh() {
+      map();
+      // a file trimmed below its header by another writer
+      if(map_bytes_ < header_bytes_) { corrupt(); }
+    }
+
+    std::vector<std::string> names() const {
+      std::vector<std::string> ans;
+      for(auto& f : fields_) { ans.push_back(f.name); }
+      return ans;
+    }
+
+    template<typename T>
+    TraceRange<T> field(const std::string& name) const {
+      const Field& f = find(name);
+      const double* rows = reinterpret_cast<const double*>(map_ + header_bytes_) + f.offset;
+      TraceIterator<T> beg(rows, width_, f.n_rows, f.n_cols);
+      return TraceRange<T>(beg, beg + size());
+    }
+  };
+
+} // namespace cppbugs
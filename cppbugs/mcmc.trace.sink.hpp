@@ -0,0 +1,224 @@
+///////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2014 Whit Armstrong                                     //
+//                                                                       //
+// This program is free software: you can redistribute it and/or modify  //
+// it under the terms of the GNU General Public License as published by  //
+// the Free Software Foundation, either version 3 of the License, or     //
+// (at your option) any later version.                                   //
+//                                                                       //
+// This program is distributed in the hope that it will be useful,       //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of        //
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         //
+// GNU General Public License for more details.                          //
+//                                                                       //
+// You should have received a copy of the GNU General Public License     //
+// along with this program.  If not, see <http://www.gnu.org/licenses/>. //
+///////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include <cppbugs/mcmc.tracked.hpp>
+#include <cppbugs/mcmc.utils.hpp>
+
+namespace cppbugs {
+
+  // single producer / single consumer ring of fixed width records
+  // the sampling thread claims and publishes, the writer thread reads and pops
+  class SPSCRing {
+  private:
+    const size_t width_, capacity_;
+    std::vector<double> buffer_;
+    // padded so head and tail don't share a cache line
+    struct Counter {
+      std::atomic<size_t> value;
+      char pad[64 - sizeof(std::atomic<size_t>)];
+      Counter(): value(0) {}
+    };
+    // head_ is only written by the producer, tail_ only by the consumer
+    Counter head_, tail_;
+  public:
+    // a zero width or capacity would make every claim() fail (or divide by zero)
+    SPSCRing(const size_t width, const size_t capacity): width_(width), capacity_(capacity) {
+      if(width == 0 || capacity == 0) {
+        throw std::logic_error("ERROR: SPSCRing needs a non-zero width and capacity.");
+      }
+      buffer_.resize(width * capacity);
+    }
+    SPSCRing(const SPSCRing&) = delete;
+    SPSCRing& operator=(const SPSCRing&) = delete;
+
+    size_t width() const { return width_; }
+
+    // slot for the next record, NULL if the ring is full
+    double* claim() {
+      const size_t head = head_.value.load(std::memory_order_relaxed);
+      if(head - tail_.value.load(std::memory_order_acquire) == capacity_) { return NULL; }
+      return &buffer_[(head % capacity_) * width_];
+    }
+    void publish() { head_.value.store(head_.value.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // oldest unread record, NULL if the ring is empty
+    const double* front() const {
+      const size_t tail = tail_.value.load(std::memory_order_relaxed);
+      if(tail == head_.value.load(std::memory_order_acquire)) { return NULL; }
+      return &buffer_[(tail % capacity_) * width_];
+    }
+    void pop() { tail_.value.store(tail_.value.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+  };
+
+  // a tracker that streams every tally out of the sampling thread:
+  // the registered values are flattened into one record per tally which is
+  // pushed into a preallocated ring and drained by a background thread into
+  // a consumer callback (or a file of raw doubles)
+  //
+  //   TraceSink sink("herd.trace");
+  //   sink.add(b_herd).add(overdisp);
+  //   m.track(sink);
+  class TraceSink : public MCMCTracked {
+  public:
+    // called on the writer thread with one record of width doubles
+    typedef std::function<void(const double*, const size_t)> Consumer;
+  private:
+    typedef std::function<void(double*)> Field;
+    std::vector<Field> fields_;
+    std::vector<size_t> offsets_;
+    size_t width_, capacity_;
+    Consumer consumer_;
+    SPSCRing* ring_;
+    std::thread writer_;
+    std::atomic<bool> closing_, failed_;
+    // only touched by the sampling thread
+    bool closed_;
+    std::exception_ptr error_;
+    std::ofstream file_;
+
+    void drain() {
+      try {
+        while(true) {
+          const double* record = ring_->front();
+          if(record) {
+            consumer_(record, width_);
+            ring_->pop();
+          } else if(closing_.load(std::memory_order_acquire)) {
+            // producer has stopped, but may have published before the flag was set
+            if(ring_->front() == NULL) { break; }
+          } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+          }
+        }
+      } catch(...) {
+        error_ = std::current_exception();
+        failed_.store(true, std::memory_order_release);
+      }
+    }
+
+    // the writer has stopped on an error, so nothing will drain the ring again
+    void check_failed() {
+      if(failed_.load(std::memory_order_acquire)) { close(); }
+    }
+
+    void check_capacity() const {
+      if(capacity_ == 0) {
+        throw std::logic_error("ERROR: a TraceSink needs room for at least one record.");
+      }
+    }
+
+    void start() {
+      if(width_ == 0) {
+        throw std::logic_error("ERROR: nothing was added to the TraceSink before tracking.");
+      }
+      ring_ = new SPSCRing(width_, capacity_);
+      writer_ = std::thread(&TraceSink::drain, this);
+    }
+  public:
+    TraceSink(Consumer consumer, const size_t capacity = 4096): width_(0), capacity_(capacity), consumer_(consumer), ring_(NULL), closing_(false), failed_(false), closed_(false) {
+      check_capacity();
+    }
+
+    // appends raw native doubles, one record (of width() doubles) per tally
+    TraceSink(const std::string& path, const size_t capacity = 4096): width_(0), capacity_(capacity), ring_(NULL), closing_(false), failed_(false), closed_(false), file_(path.c_str(), std::ios::binary | std::ios::out | std::ios::trunc) {
+      check_capacity();
+      if(!file_) {
+        throw std::runtime_error("ERROR: could not open trace file: " + path);
+      }
+      consumer_ = [this, path](const double* record, const size_t width) {
+        file_.write(reinterpret_cast<const char*>(record), width * sizeof(double));
+        if(!file_) {
+          throw std::runtime_error("ERROR: could not write trace file: " + path);
+        }
+      };
+    }
+
+    TraceSink(const TraceSink&) = delete;
+    TraceSink& operator=(const TraceSink&) = delete;
+
+    ~TraceSink() {
+      try { close(); } catch(...) {}
+      delete ring_;
+    }
+
+    // x is held by reference and read at each tally, so it must outlive the sink
+    template<typename T>
+    TraceSink& add(const T& x) {
+      if(ring_) {
+        throw std::logic_error("ERROR: cannot add to a TraceSink after tracking has started.");
+      }
+      offsets_.push_back(width_);
+      width_ += dim_size(x);
+      fields_.push_back([&x](double* out) { flat_copy(x, out); });
+      return *this;
+    }
+
+    size_t width() const { return width_; }
+    const std::vector<size_t>& offsets() const { return offsets_; }
+
+    // runs on the sampling thread: no allocation, and only waits if the writer falls behind
+    // rethrows the writer's error (i.e. a failed write) at the first tally after it happened
+    void track() {
+      if(closed_) {
+        throw std::logic_error("ERROR: cannot track to a TraceSink after it has been closed.");
+      }
+      if(ring_ == NULL) { start(); }
+      check_failed();
+      double* slot;
+      while((slot = ring_->claim()) == NULL) {
+        check_failed();
+        std::this_thread::yield();
+      }
+      for(size_t i = 0; i < fields_.size(); i++) {
+        fields_[i](slot + offsets_[i]);
+      }
+      ring_->publish();
+    }
+
+    // flush everything tallied so far and stop the writer
+    void close() {
+      closed_ = true;
+      if(writer_.joinable()) {
+        closing_.store(true, std::memory_order_release);
+        writer_.join();
+      }
+      if(file_.is_open()) {
+        file_.close();
+        if(!file_ && !error_) {
+          error_ = std::make_exception_ptr(std::runtime_error("ERROR: could not close trace file."));
+        }
+      }
+      if(error_) {
+        std::exception_ptr e = error_;
+        error_ = std::exception_ptr();
+        std::rethrow_exception(e);
+      }
+    }
+  };
+
+} // namespace cppbugs
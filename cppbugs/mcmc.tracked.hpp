@@ -17,20 +17,45 @@
 
 #pragma once
 
+#include <cppbugs/mcmc.utils.hpp>
+#include <cppbugs/mcmc.serialize.hpp>
 
 namespace cppbugs {
 
   class MCMCTracked {
   public:
     virtual void track() = 0;
+    // current value as a run of doubles (i.e. for running diagnostics)
+    // trackers that can't provide one report a size of 0
+    virtual size_t value_size() const { return 0; }
+    virtual void copy_value(double* out) const {}
+    // checkpointing (see put_history): save writes the tracker's record and
+    // appends what was tallied since the last save to the log, restore replays
+    // the log and then loads the record.  trackers that stream elsewhere save
+    // nothing and are left alone
+    virtual bool checkpointable() const { return true; }
+    virtual void save(BinaryWriter& out, BinaryWriter& log) {}
+    virtual void replay(BinaryReader& log) {}
+    virtual void load(BinaryReader& in) {}
+    // the next save starts a new log
+    virtual void rewind() {}
   };
 
   template<typename T, template<typename U, class Alloc = std::allocator<U> > class CONTAINER>
   class MCMCTrackedT : public MCMCTracked {
     const T& value_;
+    // draws already in the checkpoint log
+    size_t logged_;
   public:
     CONTAINER<T> history;
-    MCMCTrackedT(const T& value): value_(value) {}
+    MCMCTrackedT(const T& value): value_(value), logged_(0) {}
     void track() { history.push_back(value_); }
+    size_t value_size() const { return dim_size(value_); }
+    void copy_value(double* out) const { flat_copy(value_, out); }
+    bool checkpointable() const { return can_checkpoint(history); }
+    void save(BinaryWriter& out, BinaryWriter& log) { put_history(out, log, history, logged_); }
+    void replay(BinaryReader& log) { replay_history(log, history); }
+    void load(BinaryReader& in) { get_history(in, history, logged_); }
+    void rewind() { logged_ = 0; }
   };
 } // namespace cppbugs
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <stdexcept>
+#include <utility>
 #include <armadillo>
 
 namespace cppbugs {
@@ -40,8 +41,7 @@ namespace cppbugs {
   }
 
   double dim_size(const arma::subview_elem1<double, arma::Mat<arma::uword> >& x) {
-    arma::mat m(x);
-    return m.n_elem;
+    return x.a.get_ref().n_elem;
   }
 
   template<typename T>
@@ -49,6 +49,44 @@ namespace cppbugs {
     return x.n_elem;
   }
 
+  // write x out as a run of doubles (dim_size(x) of them)
+  void flat_copy(const double x, double* out) {
+    *out = x;
+  }
+
+  void flat_copy(const int x, double* out) {
+    *out = x;
+  }
+
+  void flat_copy(const bool x, double* out) {
+    *out = x;
+  }
+
+  template<typename T>
+  void flat_copy(const T& x, double* out) {
+    for(size_t i = 0; i < x.n_elem; i++) {
+      out[i] = x[i];
+    }
+  }
+
+  // exchange buffers in O(1), armadillo objects swap their memory pointers
+  void swap_values(double& a, double& b) {
+    std::swap(a,b);
+  }
+
+  void swap_values(int& a, int& b) {
+    std::swap(a,b);
+  }
+
+  void swap_values(bool& a, bool& b) {
+    std::swap(a,b);
+  }
+
+  template<typename T>
+  void swap_values(T& a, T& b) {
+    a.swap(b);
+  }
+
   template<typename T, typename U, typename V>
   void dimension_check(const T& x, const U& hyper1, const V& hyper2) {
     if(dim_size(hyper1) > dim_size(x) || dim_size(hyper2) > dim_size(x)) {
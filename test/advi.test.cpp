@@ -0,0 +1,99 @@
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/mcmc.advi.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+#include <cppbugs/distributions/mcmc.wishart.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+typedef BoostRng<boost::minstd_rand> Rng;
+
+int main() {
+  bool failed = false;
+
+  const int NR = 100;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,2);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+
+  // tau_y has a bounded support, mapped through a logit
+  vec b_mean[3], b_sd[3];
+  double tau_mean[3], tau_sd[3];
+  for(int run = 0; run < 3; run++) {
+    vec b = zeros<vec>(2);
+    mat y_hat = X * b;
+    double tau_y(1);
+
+    Rng rng;
+    MCModel m(rng);
+    m.link<Normal>(b, 0, 0.001);
+    m.link<Uniform>(tau_y, 0, 100);
+    m.link<Linear>(y_hat, X, b);
+    m.link<ObservedNormal>(y, y_hat, tau_y);
+
+    std::vector<vec>& b_hist = m.track<std::vector>(b);
+    std::vector<double>& tau_y_hist = m.track<std::vector>(tau_y);
+
+    // run 0 is plain MH, then mean field and full rank
+    if(run == 0) {
+      m.tune(1e4,100);
+      m.tune_global(1e4,100);
+      m.burn(1e4);
+      m.sample(1e5,10);
+    } else {
+      ADVI advi(m, rng, run == 2, 10);
+      // windows of 500 iterations: over 100 the elbo of this model moves by
+      // less than 1% well before tau_y settles
+      const int iterations = advi.fit(3e4, 1e-4, 500);
+      advi.sample(1e4);
+      cout << (run == 2 ? "full rank" : "mean field") << ": " << iterations << " iterations, elbo " << advi.elbo() << endl;
+    }
+    b_mean[run] = mean(b_hist.begin(), b_hist.end());
+    b_sd[run] = sd(b_hist.begin(), b_hist.end());
+    tau_mean[run] = mean(tau_y_hist.begin(), tau_y_hist.end());
+    tau_sd[run] = sd(tau_y_hist.begin(), tau_y_hist.end());
+  }
+
+  const char* names[] = { "mh", "mean field", "full rank" };
+  for(int run = 0; run < 3; run++) {
+    cout << names[run] << ": b " << b_mean[run].t();
+    cout << names[run] << ": sd(b) " << b_sd[run].t();
+    cout << names[run] << ": tau " << tau_mean[run] << " sd " << tau_sd[run] << endl;
+  }
+  // means within 0.3 posterior sd of MH for both fits (the mean of q keeps
+  // moving by about a fifth of an sd between iterations); only the
+  // full rank fit can follow the correlation of the intercept and slope, so
+  // only its sds are checked (within 15%)
+  for(int run = 1; run < 3; run++) {
+    if(accu(abs(b_mean[run] - b_mean[0]) > 0.3 * b_sd[0]) > 0 || std::abs(tau_mean[run] - tau_mean[0]) > 0.3 * tau_sd[0]) { failed = true; }
+  }
+  if(accu(abs(b_sd[2] - b_sd[0]) > 0.15 * b_sd[0]) > 0) { failed = true; }
+
+  // q is over the flat state, which doesn't hold a Wishart node
+  try {
+    mat sigma = eye(2,2);
+    const mat sigma_prior = eye(2,2);
+    Rng rng;
+    MCModel m(rng);
+    m.link<Wishart>(sigma, sigma_prior, 5.0);
+    ADVI advi(m, rng);
+    cout << "a Wishart node was accepted" << endl;
+    failed = true;
+  } catch(std::logic_error& e) {
+    cout << "rejected: " << e.what() << endl;
+  }
+
+  if(failed) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+}
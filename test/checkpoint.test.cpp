@@ -0,0 +1,119 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/mcmc.running.stats.hpp>
+#include <cppbugs/mcmc.quantile.sketch.hpp>
+#include <cppbugs/mcmc.thinned.history.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+#include <cppbugs/distributions/mcmc.wishart.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+const std::string checkpoint_file("checkpoint.test.bin");
+const int iterations = 10000;
+const int thin = 5;
+const int checkpoint_every = 1000;
+const int crash_at = 6500;
+
+enum Run { full, crash, resume };
+
+// everything a run reports, flattened so runs can be compared bit for bit
+vec run(const Run mode, const mat& X, const mat& y) {
+  vec b = zeros<vec>(2);
+  mat y_hat = X * b;
+  double tau_y(1);
+  // a Wishart node isn't part of the flat state, so it's checkpointed on its own
+  mat sigma = eye(2,2);
+  const mat sigma_prior = eye(2,2);
+
+  BoostRng<boost::minstd_rand> rng;
+  MCModel m(rng);
+
+  m.link<Normal>(b, 0, 0.001);
+  m.link<Uniform>(tau_y, 0, 100);
+  m.link<Linear>(y_hat, X, b);
+  m.link<ObservedNormal>(y, y_hat, tau_y);
+  m.link<Wishart>(sigma, sigma_prior, 5.0);
+
+  std::vector<vec>& b_hist = m.track<std::vector>(b);
+  std::vector<mat>& sigma_hist = m.track<std::vector>(sigma);
+  RunningStats<double>& tau_y_stats = m.track<RunningStats>(tau_y);
+  QuantileSketch<vec>& b_quantiles = m.track<QuantileSketch>(b);
+  ThinnedHistory<double>& tau_y_thinned = m.track<ThinnedHistory>(tau_y);
+  tau_y_thinned.set_capacity(100);
+
+  m.set_checkpoint(checkpoint_file, checkpoint_every);
+  if(mode == resume) {
+    if(!m.restore(checkpoint_file)) {
+      throw std::logic_error("ERROR: no checkpoint to resume from.");
+    }
+    cout << "resumed " << m.resumed_phase() << " at " << m.resumed_iteration() << " with " << b_hist.size() << " draws" << endl;
+    m.sample(iterations - m.resumed_iteration(), thin);
+  } else {
+    m.tune(1000,100);
+    m.tune_global(1000,100);
+    m.burn(1000);
+    m.sample(mode == crash ? crash_at : iterations, thin);
+  }
+  m.flush_checkpoint();
+
+  std::vector<double> ans;
+  for(auto& x : b_hist) { ans.insert(ans.end(), x.begin(), x.end()); }
+  for(auto& x : sigma_hist) { ans.insert(ans.end(), x.begin(), x.end()); }
+  ans.insert(ans.end(), tau_y_thinned.begin(), tau_y_thinned.end());
+  ans.push_back(tau_y_thinned.thin());
+  ans.push_back(tau_y_stats.mean());
+  ans.push_back(tau_y_stats.sd());
+  const vec q = b_quantiles.quantile(0.9);
+  ans.insert(ans.end(), q.begin(), q.end());
+  ans.push_back(m.acceptance_ratio());
+  ans.push_back(tau_y);
+  return vec(ans.data(), ans.size());
+}
+
+size_t file_size(const std::string& path) {
+  std::ifstream f(path.c_str(), std::ios::binary | std::ios::ate);
+  return f ? static_cast<size_t>(f.tellg()) : 0;
+}
+
+int main() {
+  const int NR = 1e2;
+  const int NC = 2;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,NC);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+
+  const std::string log_file(checkpoint_file + ".draws");
+  std::remove(checkpoint_file.c_str());
+  std::remove(log_file.c_str());
+
+  const vec uninterrupted = run(full, X, y);
+  run(crash, X, y);
+  // a crashed run may have logged past its last checkpoint, which a resume must drop
+  std::ofstream(log_file.c_str(), std::ios::binary | std::ios::app) << "half written draws";
+  const size_t checkpoint_bytes = file_size(checkpoint_file);
+  const vec resumed = run(resume, X, y);
+  const size_t log_bytes = file_size(log_file);
+
+  cout << "checkpoint: " << checkpoint_bytes << " bytes, draws log: " << log_bytes << " bytes" << endl;
+  cout << "values compared: " << uninterrupted.n_elem << endl;
+
+  std::remove(checkpoint_file.c_str());
+  std::remove(log_file.c_str());
+
+  if(uninterrupted.n_elem != resumed.n_elem || accu(abs(uninterrupted - resumed)) != 0) {
+    cout << "FAILED: resumed run differs from the uninterrupted one" << endl;
+    return 1;
+  }
+  cout << "resumed run matches the uninterrupted one bit for bit" << endl;
+  return 0;
+};
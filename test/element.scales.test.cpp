@@ -0,0 +1,64 @@
+#include <iostream>
+#include <vector>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/deterministics/mcmc.gather.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+// ten group means, five seen once and five seen 400 times, so the posterior
+// sds differ by a factor of 20 within one vector node
+int main() {
+  const int J = 10;
+  uvec group(J/2 * (1 + 400));
+  for(size_t i = 0, j = 0; j < J; j++) {
+    const int n = j < J/2 ? 1 : 400;
+    for(int k = 0; k < n; k++) { group[i++] = j; }
+  }
+  vec y = randn<vec>(group.n_elem);
+  for(size_t i = 0; i < group.n_elem; i++) { y[i] += group[i]; }
+
+  // scalar scale only (tune_global doesn't learn element scales) vs learned element scales
+  vec ess_a[2];
+  vec element_scales;
+  for(int learned = 0; learned < 2; learned++) {
+    vec a = zeros<vec>(J);
+    vec a_full;
+
+    BoostRng<boost::minstd_rand> rng;
+    MCModel m(rng);
+
+    auto& a_node = m.link<Normal>(a, 0, 0.01);
+    m.link<Gather>(a_full, a, group);
+    m.link<ObservedNormal>(y, a_full, 1.0);
+
+    std::vector<vec>& a_hist = m.track<std::vector>(a);
+
+    if(learned) {
+      m.tune(2000,20);
+      m.tune_global(2000,20);
+      element_scales = a_node.getElementScales();
+    } else {
+      m.tune_global(4000,20);
+    }
+    m.burn(1000);
+    m.sample(20000, 1);
+    ess_a[learned] = ess(a_hist.begin(),a_hist.end());
+  }
+
+  cout << "learned element scales: " << element_scales.t();
+  cout << "ess (scalar scale): " << ess_a[0].t();
+  cout << "ess (element scales): " << ess_a[1].t();
+
+  // the poorly observed means are the ones the scalar scale can't reach
+  const vec poor_scalar = ess_a[0].rows(0, J/2 - 1), poor_learned = ess_a[1].rows(0, J/2 - 1);
+  if(element_scales.n_elem != J || min(poor_learned) < 5 * max(poor_scalar)) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+};
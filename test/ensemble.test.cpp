@@ -0,0 +1,102 @@
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/mcmc.ensemble.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+#include <cppbugs/distributions/mcmc.wishart.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+typedef BoostRng<boost::minstd_rand> Rng;
+
+int main() {
+  bool failed = false;
+
+  const int NR = 100;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,2);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+  auto linear = [&](MCModel& m) -> std::vector<vec>& {
+    vec& b = m.make<vec>(zeros<vec>(2));
+    mat& y_hat = m.make<mat>(X * b);
+    double& tau_y = m.make<double>(1.0);
+    m.link<Normal>(b, 0, 0.001);
+    m.link<Uniform>(tau_y, 0, 100);
+    m.link<Linear>(y_hat, X, b);
+    m.link<ObservedNormal>(y, y_hat, tau_y);
+    return m.track<std::vector>(b);
+  };
+
+  Rng rng;
+  MCModel mh(rng);
+  std::vector<vec>& b_mh = linear(mh);
+  mh.tune(1e4,100);
+  mh.tune_global(1e4,100);
+  mh.burn(1e4);
+  mh.sample(1e5,10);
+
+  // the same run on 1 and 4 threads: all draws are made on the calling thread
+  vec b_mean[2];
+  mat walkers[2];
+  for(int run = 0; run < 2; run++) {
+    std::vector<vec>* b_es = NULL;
+    EnsembleSampler<Rng> es([&](MCModel& m, const size_t t) {
+        std::vector<vec>& b_hist = linear(m);
+        if(t == 0) { b_es = &b_hist; }
+      }, 32, run ? 4 : 1);
+    es.burn(2000);
+    es.resetAcceptanceRatio();
+    es.sample(5000, 10);
+    b_mean[run] = mean(b_es->begin(), b_es->end());
+    walkers[run] = es.walkers();
+    cout << "ensemble (" << (run ? 4 : 1) << " threads): b " << b_mean[run].t();
+    cout << "ensemble: draws " << b_es->size() << " acceptance " << es.acceptance_ratio() << endl;
+  }
+  const vec b_mean_mh = mean(b_mh.begin(), b_mh.end());
+  const vec b_sd = sd(b_mh.begin(), b_mh.end());
+  cout << "mh: b " << b_mean_mh.t();
+  // within a tenth of a posterior sd
+  if(accu(abs(b_mean[0] - b_mean_mh) > 0.1 * b_sd) > 0) { failed = true; }
+  if(accu(abs(walkers[0] - walkers[1])) != 0) {
+    cout << "thread count changed the walkers" << endl;
+    failed = true;
+  }
+
+  // the walkers must span the state: 6 parameters need more than 6 walkers
+  try {
+    EnsembleSampler<Rng> few([&](MCModel& m, const size_t) {
+        vec& b = m.make<vec>(zeros<vec>(6));
+        m.link<Normal>(b, 0, 1.0);
+      }, 6);
+    cout << "6 walkers were accepted for 6 parameters" << endl;
+    failed = true;
+  } catch(std::logic_error& e) {
+    cout << "rejected: " << e.what() << endl;
+  }
+
+  // logp is evaluated at a flat state, which doesn't hold a Wishart node
+  try {
+    const mat sigma_prior = eye(2,2);
+    EnsembleSampler<Rng> bad([&](MCModel& m, const size_t) {
+        mat& sigma = m.make<mat>(eye(2,2));
+        m.link<Wishart>(sigma, sigma_prior, 5.0);
+      }, 8);
+    cout << "a Wishart node was accepted" << endl;
+    failed = true;
+  } catch(std::logic_error& e) {
+    cout << "rejected: " << e.what() << endl;
+  }
+
+  if(failed) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+}
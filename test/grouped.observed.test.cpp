@@ -0,0 +1,123 @@
+#include <iostream>
+#include <vector>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/distributions/mcmc.observed.grouped.hpp>
+#include <cppbugs/deterministics/mcmc.gather.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+// the same model with and without sufficient statistics, both sampled by MH
+template<typename F>
+vec posterior_mean(F link) {
+  BoostRng<boost::minstd_rand> rng;
+  MCModel m(rng);
+  vec& theta = link(m);
+  std::vector<vec>& theta_hist = m.track<std::vector>(theta);
+  m.tune(1e4,100);
+  m.tune_global(1e4,100);
+  m.burn(1e4);
+  m.sample(1e5, 10);
+  return mean(theta_hist.begin(),theta_hist.end());
+}
+
+int main() {
+  const int N = 400;
+  const int G = 5;
+  uvec group(N);
+  for(int i = 0; i < N; i++) { group[i] = i % G; }
+
+  const vec noise = randn<vec>(N);
+  vec y_data(N);
+  ivec counts_data(N), size_data(N), successes_data(N);
+  for(int i = 0; i < N; i++) {
+    y_data[i] = group[i] + noise[i];
+    counts_data[i] = (i * 7) % (3 + group[i]);
+    size_data[i] = 10;
+    successes_data[i] = (i * 3) % (2 + 2 * group[i]);
+  }
+  const vec y(y_data);
+  const ivec counts(counts_data), size(size_data), successes(successes_data);
+
+  // the sufficient statistics must reproduce the per-observation loglik up to rounding
+  vec mu_check(G), mu_check_full(N);
+  for(int j = 0; j < G; j++) { mu_check[j] = 0.5 + 0.5 * j; }
+  for(int i = 0; i < N; i++) { mu_check_full[i] = mu_check[group[i]]; }
+  const vec p_check = mu_check / 3;
+  const vec p_check_full = mu_check_full / 3;
+  const double tau_check(1.3);
+  vec normal_ll = zeros<vec>(N), poisson_ll = zeros<vec>(N), binomial_ll = zeros<vec>(N);
+  normal_logp_elements(normal_ll, y, mu_check_full, tau_check);
+  poisson_logp_elements(poisson_ll, counts, mu_check_full);
+  binomial_logp_elements(binomial_ll, successes, size, p_check_full);
+  const double ll_diff[] = {
+    ObservedNormalGrouped<vec,vec,double,uvec>(y, mu_check, tau_check, group).loglik() - accu(normal_ll),
+    ObservedPoissonGrouped<ivec,vec,uvec>(counts, mu_check, group).loglik() - accu(poisson_ll),
+    ObservedBinomialGrouped<ivec,ivec,vec,uvec>(successes, size, p_check, group).loglik() - accu(binomial_ll)
+  };
+  for(double d : ll_diff) {
+    if(std::abs(d) > 1e-6) {
+      cout << "FAILED: grouped loglik differs by " << d << endl;
+      return 1;
+    }
+  }
+
+  double tau_y(1);
+  vec mu = zeros<vec>(G), mu_full;
+  vec rate = ones<vec>(G), rate_full;
+  vec p = ones<vec>(G) * 0.5, p_full;
+
+  const vec normal_grouped = posterior_mean([&](MCModel& m) -> vec& {
+      m.link<Normal>(mu, 0, 0.001);
+      m.link<Uniform>(tau_y, 0, 100);
+      m.link<ObservedNormalGrouped>(y, mu, tau_y, group);
+      return mu;
+    });
+  const vec normal_full = posterior_mean([&](MCModel& m) -> vec& {
+      m.link<Normal>(mu, 0, 0.001);
+      m.link<Uniform>(tau_y, 0, 100);
+      m.link<Gather>(mu_full, mu, group);
+      m.link<ObservedNormal>(y, mu_full, tau_y);
+      return mu;
+    });
+  const vec poisson_grouped = posterior_mean([&](MCModel& m) -> vec& {
+      m.link<Gamma>(rate, 0.1, 0.1);
+      m.link<ObservedPoissonGrouped>(counts, rate, group);
+      return rate;
+    });
+  const vec poisson_full = posterior_mean([&](MCModel& m) -> vec& {
+      m.link<Gamma>(rate, 0.1, 0.1);
+      m.link<Gather>(rate_full, rate, group);
+      m.link<ObservedPoisson>(counts, rate_full);
+      return rate;
+    });
+  const vec binomial_grouped = posterior_mean([&](MCModel& m) -> vec& {
+      m.link<Beta>(p, 1.0, 1.0);
+      m.link<ObservedBinomialGrouped>(successes, size, p, group);
+      return p;
+    });
+  const vec binomial_full = posterior_mean([&](MCModel& m) -> vec& {
+      m.link<Beta>(p, 1.0, 1.0);
+      m.link<Gather>(p_full, p, group);
+      m.link<ObservedBinomial>(successes, size, p_full);
+      return p;
+    });
+
+  cout << "normal mu (grouped, full): " << endl << normal_grouped.t() << normal_full.t();
+  cout << "poisson rate (grouped, full): " << endl << poisson_grouped.t() << poisson_full.t();
+  cout << "binomial p (grouped, full): " << endl << binomial_grouped.t() << binomial_full.t();
+
+  // both chains carry monte carlo error, so allow a few percent of the posterior mean
+  const double tolerance = 0.05;
+  if(any(abs(normal_grouped - normal_full) > tolerance * (1 + abs(normal_full))) ||
+     any(abs(poisson_grouped - poisson_full) > tolerance * (1 + abs(poisson_full))) ||
+     any(abs(binomial_grouped - binomial_full) > tolerance * (1 + abs(binomial_full)))) {
+    cout << "FAILED: grouped and ungrouped posteriors differ" << endl;
+    return 1;
+  }
+  return 0;
+};
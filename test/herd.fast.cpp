@@ -5,13 +5,13 @@
 #include <cppbugs/cppbugs.hpp>
 #include <cppbugs/mcmc.boost.rng.hpp>
 #include <cppbugs/mcmc.model.hpp>
+#include <cppbugs/deterministics/mcmc.gather.hpp>
 
 using namespace arma;
 using namespace cppbugs;
 using namespace std;
 
 
-typedef arma::subview_elem1<double, arma::Mat<uword> > replicatedT;
 
 template<typename T, typename U, typename V, typename W, typename X>
 class LogisticWithConstAndOverdispersion : public Deterministic<T> {
@@ -59,7 +59,7 @@ int main() {
   vec overdisp(randn<vec>(N));
   vec phi;
   double tau_overdisp(1), tau_b_herd(1);
-  replicatedT b_herd_full = b_herd.elem(herd);
+  vec b_herd_full;
 
   // std::function<void ()> model = [&]() {
   //   phi = b_herd.elem(herd) + fixed*b + overdisp;
@@ -72,9 +72,13 @@ int main() {
   m.link<Uniform>(tau_overdisp, 0, 1000);
   m.link<Uniform>(tau_b_herd, 0, 100);
   m.link<Normal>(b_herd, 0, tau_b_herd);
-  m.link<Normal>(overdisp, 0, tau_overdisp);
+  m.link<Gather>(b_herd_full, b_herd, herd);
+  Normal<vec,int,double>& overdisp_node = m.link<Normal>(overdisp, 0, tau_overdisp);
   m.link<LogisticWithConstAndOverdispersion>(phi,fixed,b_herd_full,b,overdisp);
-  m.link<ObservedBinomial>(incidence, size, phi);
+  ObservedBinomial<ivec,ivec,vec>& incidence_node = m.link<ObservedBinomial>(incidence, size, phi);
+
+  // each overdisp element only touches its own observation
+  m.independent(overdisp_node, incidence_node);
 
   // things to track
   std::vector<vec>& b_hist = m.track<std::vector>(b);
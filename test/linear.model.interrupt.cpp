@@ -0,0 +1,83 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+int main() {
+  const int NR = 1e2;
+  const int NC = 2;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,NC);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+
+  vec b = randn<vec>(2);
+  mat y_hat = X * b;
+  double tau_y(1);
+
+  BoostRng<boost::minstd_rand> rng;
+  MCModel m(rng);
+
+  m.link<Normal>(b, 0, 0.001);
+  m.link<Uniform>(tau_y, 0, 100);
+  m.link<Linear>(y_hat, X, b);
+  m.link<ObservedNormal>(y, y_hat, tau_y);
+
+  std::vector<vec>& b_hist = m.track<std::vector>(b);
+
+  int progress_calls(0);
+  bool progress_ok(true);
+  m.set_progress([&](const char* phase, int i, int iterations) {
+      progress_calls++;
+      progress_ok = progress_ok && i % 1000 == 0 && i <= iterations;
+    }, 1000);
+
+  m.tune(1e4,100);
+  m.tune_global(1e4,100);
+  m.burn(1e4);
+  const int tuning_calls = progress_calls;
+
+  // a time budget instead of an iteration count
+  const int thin = 10;
+  const std::chrono::milliseconds budget(100);
+  const auto start = std::chrono::steady_clock::now();
+  const int sampled = m.sample_for(budget, thin);
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+  // cancelled from another thread
+  std::thread canceller([&m]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+      m.cancel();
+    });
+  const int burned = m.burn(1e8);
+  canceller.join();
+  const bool was_cancelled = m.cancelled();
+  const int after_cancel = m.sample(1e4, 1);
+  m.reset_cancel();
+  const int after_reset = m.sample(1e4, 1);
+
+  cout << "progress calls while tuning: " << tuning_calls << endl;
+  cout << "sample_for: " << sampled << " iterations in " << elapsed.count() << "ms, draws: " << b_hist.size() - after_cancel - after_reset << endl;
+  cout << "cancelled burn after: " << burned << " iterations" << endl;
+  cout << "sample while cancelled: " << after_cancel << " after reset: " << after_reset << endl;
+  cout << "b: " << endl << mean(b_hist.begin(),b_hist.end()) << endl;
+
+  if(!progress_ok || tuning_calls != 30 ||
+     sampled % 1000 != 0 || b_hist.size() != static_cast<size_t>(sampled / thin + after_cancel + after_reset) ||
+     elapsed < budget || !was_cancelled || burned >= 1e8 ||
+     after_cancel != 1000 || after_reset != 1e4) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+};
@@ -0,0 +1,58 @@
+#include <iostream>
+#include <vector>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+int main() {
+  const int NR = 1e2;
+  const int NC = 2;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,NC);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+
+  vec b = randn<vec>(2);
+  mat y_hat = X * b;
+  double tau_y(1);
+
+  BoostRng<boost::minstd_rand> rng;
+  MCModel m(rng);
+
+  m.link<Normal>(b, 0, 0.001);
+  m.link<Uniform>(tau_y, 0, 100);
+  m.link<Linear>(y_hat, X, b);
+  m.link<ObservedNormal>(y, y_hat, tau_y);
+
+  std::vector<vec>& b_hist = m.track<std::vector>(b);
+  std::vector<double>& tau_y_hist = m.track<std::vector>(tau_y);
+
+  m.tune(1e4,100);
+  m.tune_global(1e4,100);
+  m.burn(1e4);
+
+  // stops on the batch means estimate, checked here against the fft estimate
+  const double target_ess = 2000;
+  const int max_iterations = 1e6;
+  const int iterations = m.sample_until(target_ess, max_iterations);
+  const vec b_ess = ess(b_hist.begin(),b_hist.end());
+  const double tau_y_ess = ess(tau_y_hist.begin(),tau_y_hist.end());
+
+  cout << "iterations: " << iterations << endl;
+  cout << "b ess: " << b_ess.t();
+  cout << "tau_y ess: " << tau_y_ess << endl;
+  cout << "b: " << endl << mean(b_hist.begin(),b_hist.end()) << endl;
+
+  // the batch means estimate is rough, so allow it to overshoot the fft one somewhat
+  if(iterations >= max_iterations || min(b_ess) < 0.7 * target_ess || tau_y_ess < 0.7 * target_ess) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+};
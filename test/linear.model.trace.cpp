@@ -0,0 +1,96 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/mcmc.trace.file.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+int main() {
+  const int NR = 1e2;
+  const int NC = 2;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,NC);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+
+  vec coefs;
+  solve(coefs, X, y);
+
+  vec b = randn<vec>(2);
+  mat y_hat = X * b;
+  double tau_y(1);
+
+  BoostRng<boost::minstd_rand> rng;
+  MCModel m(rng);
+
+  m.link<Normal>(b, 0, 0.001);
+  m.link<Uniform>(tau_y, 0, 100);
+  m.link<Linear>(y_hat, X, b);
+  m.link<ObservedNormal>(y, y_hat, tau_y);
+
+  // draws go to disk instead of memory
+  TraceFile trace("linear.model.trace.bin");
+  trace.add("b", b).add("tau_y", tau_y);
+  m.track(trace);
+
+  m.tune(1e4,100);
+  m.tune_global(1e4,100);
+  m.burn(1e4);
+  m.sample(1e5, 10);
+  trace.close();
+
+  // mapped back in without copying
+  TraceFileReader reader("linear.model.trace.bin");
+  TraceRange<vec> b_hist = reader.field<vec>("b");
+  TraceRange<double> tau_y_hist = reader.field<double>("tau_y");
+
+  cout << "lm coefs" << endl << coefs;
+  cout << "b: " << endl << mean(b_hist.begin(),b_hist.end()) << endl;
+  cout << "b sd: " << endl << sd(b_hist.begin(),b_hist.end()) << endl;
+  cout << "tau_y: " << mean(tau_y_hist.begin(),tau_y_hist.end()) << endl;
+  cout << "samples: " << reader.size() << endl;
+  cout << "acceptance_ratio: " << m.acceptance_ratio() << endl;
+
+  // sampling on after close must not overwrite the file
+  try {
+    m.sample(10, 1);
+    cout << "FAILED: tracked into a closed TraceFile" << endl;
+    return 1;
+  } catch(std::logic_error& e) {
+    cout << "closed trace: " << e.what() << endl;
+  }
+  if(TraceFileReader("linear.model.trace.bin").size() != reader.size()) {
+    cout << "FAILED: closed TraceFile was modified" << endl;
+    return 1;
+  }
+
+  // a header that points outside the file is rejected before any row is read
+  std::ifstream in("linear.model.trace.bin", std::ios::binary);
+  const std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::string truncated(bytes, 0, 100), bad_offset(bytes);
+  const uint64_t offset = 1000;
+  // the first field's offset follows its n_rows and n_cols
+  bad_offset.replace(trace_file::fields_at + 16, sizeof(offset), reinterpret_cast<const char*>(&offset), sizeof(offset));
+  const std::string corrupt[] = { truncated, bad_offset };
+  for(auto& c : corrupt) {
+    std::ofstream("linear.model.trace.bad", std::ios::binary) << c;
+    try {
+      TraceFileReader bad("linear.model.trace.bad");
+      cout << "FAILED: a corrupt trace file was opened" << endl;
+      return 1;
+    } catch(std::runtime_error& e) {
+      cout << "corrupt trace: " << e.what() << endl;
+    }
+  }
+
+  return 0;
+};
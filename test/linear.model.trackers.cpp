@@ -0,0 +1,145 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/mcmc.running.stats.hpp>
+#include <cppbugs/mcmc.quantile.sketch.hpp>
+#include <cppbugs/mcmc.thinned.history.hpp>
+#include <cppbugs/mcmc.summary.stats.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+// the bounded memory trackers against the full history of the same run
+int main() {
+  const int NR = 1e2;
+  const int NC = 2;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,NC);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+
+  vec b = randn<vec>(2);
+  mat y_hat = X * b;
+  double tau_y(1);
+
+  BoostRng<boost::minstd_rand> rng;
+  MCModel m(rng);
+
+  m.link<Normal>(b, 0, 0.001);
+  m.link<Uniform>(tau_y, 0, 100);
+  m.link<Linear>(y_hat, X, b);
+  m.link<ObservedNormal>(y, y_hat, tau_y);
+
+  std::vector<vec>& b_hist = m.track<std::vector>(b);
+  std::vector<double>& tau_y_hist = m.track<std::vector>(tau_y);
+  RunningStats<vec>& b_stats = m.track<RunningStats>(b);
+  b_stats.enable_covariance();
+  RunningStats<double>& tau_y_stats = m.track<RunningStats>(tau_y);
+  QuantileSketch<vec>& b_quantiles = m.track<QuantileSketch>(b);
+  ThinnedHistory<vec>& b_thinned = m.track<ThinnedHistory>(b);
+  b_thinned.set_capacity(1000);
+
+  m.tune(1e4,100);
+  m.tune_global(1e4,100);
+  m.burn(1e4);
+  m.sample(1e5, 10);
+
+  const vec b_mean = mean(b_hist.begin(),b_hist.end());
+  const vec b_sd = sd(b_hist.begin(),b_hist.end());
+  mat b_cov = zeros<mat>(NC,NC);
+  for(const vec& x : b_hist) { b_cov += (x - b_mean) * (x - b_mean).t(); }
+  b_cov /= b_hist.size() - 1;
+
+  // the same draws split in two and merged back
+  RunningStats<vec> first, second;
+  for(size_t i = 0; i < b_hist.size(); i++) {
+    (i < b_hist.size() / 3 ? first : second).push_back(b_hist[i]);
+  }
+  first.merge(second);
+
+  cout << "b (history, running): " << endl << b_mean.t() << b_stats.mean().t();
+  cout << "b sd (history, running, merged): " << endl << b_sd.t() << b_stats.sd().t() << first.sd().t();
+  cout << "b cov (history, running): " << endl << b_cov << b_stats.covariance();
+  cout << "tau_y (history, running): " << mean(tau_y_hist.begin(),tau_y_hist.end()) << " " << tau_y_stats.mean() << endl;
+
+  // rank of each sketched quantile among the stored draws
+  const double probs[] = { 0, 0.025, 0.5, 0.975, 1 };
+  double max_rank_error(0);
+  cout << "b quantiles (sketch, history):" << endl;
+  for(double q : probs) {
+    const vec sketched = b_quantiles.quantile(q);
+    for(int j = 0; j < NC; j++) {
+      std::vector<double> draws;
+      for(const vec& x : b_hist) { draws.push_back(x[j]); }
+      std::sort(draws.begin(), draws.end());
+      const double rank = static_cast<double>(std::upper_bound(draws.begin(), draws.end(), sketched[j]) - draws.begin()) / draws.size();
+      const size_t exact = std::min<size_t>(q * draws.size(), draws.size() - 1);
+      cout << " " << q << ": " << sketched[j] << " " << draws[exact] << endl;
+      max_rank_error = std::max(max_rank_error, std::abs(rank - q));
+    }
+  }
+  cout << "max quantile rank error: " << max_rank_error << endl;
+
+  // every thin'th draw of the full history, and nothing else
+  bool thinned_ok = b_thinned.count() == b_hist.size() &&
+    b_thinned.size() >= b_thinned.capacity() / 2 && b_thinned.size() <= b_thinned.capacity();
+  for(size_t i = 0; thinned_ok && i < b_thinned.size(); i++) {
+    thinned_ok = accu(abs(b_thinned[i] - b_hist[i * b_thinned.thin()])) == 0;
+  }
+  cout << "b (history, thinned): " << endl << b_mean.t() << mean(b_thinned.begin(),b_thinned.end()).t();
+  cout << "thinned draws: " << b_thinned.size() << " thin: " << b_thinned.thin() << endl;
+
+  // AR(1) chains with phi = 0.9 have ess = n (1 - phi) / (1 + phi), white noise ess = n
+  boost::minstd_rand ar_engine(3);
+  boost::normal_distribution<double> ar_normal;
+  boost::variate_generator<boost::minstd_rand&, boost::normal_distribution<double> > ar_draw(ar_engine, ar_normal);
+  const int n_chains = 4, n_draws = 20000;
+  const double phi = 0.9;
+  std::vector<std::vector<vec> > ar_chains(n_chains);
+  for(auto& chain : ar_chains) {
+    vec x = zeros<vec>(2);
+    for(int i = 0; i < n_draws; i++) {
+      x[0] = phi * x[0] + ar_draw();
+      x[1] = ar_draw();
+      chain.push_back(x);
+    }
+  }
+  const vec ar_ess = ess(ar_chains), ar_rhat = rhat(ar_chains), ar_mcse = mcse(ar_chains);
+  vec ar_expected(2);
+  ar_expected[0] = n_chains * n_draws * (1 - phi) / (1 + phi);
+  ar_expected[1] = n_chains * n_draws;
+  cout << "ar ess (estimated, expected): " << endl << ar_ess.t() << ar_expected.t();
+  cout << "ar rhat: " << ar_rhat.t();
+  cout << "ar mcse: " << ar_mcse.t();
+
+  // one chain of the sampler, split in half for rhat
+  cout << "b ess: " << ess(b_hist.begin(),b_hist.end()).t();
+  cout << "b rhat: " << rhat(b_hist.begin(),b_hist.end()).t();
+  cout << "b mcse: " << mcse(b_hist.begin(),b_hist.end()).t();
+
+  const double tolerance = 1e-8;
+  bool ok = b_stats.size() == b_hist.size() &&
+    max(abs(b_stats.mean() - b_mean)) < tolerance &&
+    max(abs(b_stats.sd() - b_sd)) < tolerance &&
+    accu(abs(b_stats.covariance() - b_cov)) < tolerance &&
+    max(abs(first.mean() - b_mean)) < tolerance &&
+    max(abs(first.sd() - b_sd)) < tolerance &&
+    std::abs(tau_y_stats.mean() - mean(tau_y_hist.begin(),tau_y_hist.end())) < tolerance &&
+    std::abs(tau_y_stats.sd() - sd(tau_y_hist.begin(),tau_y_hist.end())) < tolerance &&
+    max_rank_error < 0.005 &&
+    thinned_ok &&
+    all(abs(ar_ess / ar_expected - 1) < 0.15) &&
+    all(abs(ar_rhat - 1) < 0.01);
+
+  if(!ok) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+};
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+int main() {
+  const int NR = 1e2;
+  const int NC = 2;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,NC);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+
+  // global target for b and tau_y (3 elements): 1/log2(3 + 3)
+  const double target_ar = 1 / std::log2(6.0);
+
+  // a short tuning schedule against the one in linear.model.test
+  const int schedule[] = { 500, 10000 };
+  const int steps[] = { 10, 100 };
+  vec b_mean[2];
+  double ar[2];
+  for(int k = 0; k < 2; k++) {
+    vec b = randn<vec>(2);
+    mat y_hat = X * b;
+    double tau_y(1);
+
+    BoostRng<boost::minstd_rand> rng;
+    MCModel m(rng);
+
+    m.link<Normal>(b, 0, 0.001);
+    m.link<Uniform>(tau_y, 0, 100);
+    m.link<Linear>(y_hat, X, b);
+    m.link<ObservedNormal>(y, y_hat, tau_y);
+
+    std::vector<vec>& b_hist = m.track<std::vector>(b);
+
+    m.tune(schedule[k], steps[k]);
+    m.tune_global(schedule[k], steps[k]);
+    m.burn(1e4);
+    m.sample(1e5, 10);
+    b_mean[k] = mean(b_hist.begin(),b_hist.end());
+    ar[k] = m.acceptance_ratio();
+    cout << "tune(" << schedule[k] << "," << steps[k] << ") + tune_global(" << schedule[k] << "," << steps[k] << ")" << endl;
+    cout << "  b: " << b_mean[k].t();
+    cout << "  acceptance_ratio: " << ar[k] << " target: " << target_ar << endl;
+  }
+
+  if(std::abs(ar[0] - target_ar) > 0.05 || std::abs(ar[1] - target_ar) > 0.05 || max(abs(b_mean[0] - b_mean[1])) > 0.01) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+};
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+int main() {
+  const int NR = 1e2;
+  const int NC = 2;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,NC);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+
+  const std::string tuning_file("linear.model.warm.start.bin");
+  std::remove(tuning_file.c_str());
+
+  // cold: the full schedule of linear.model.test, then save what it learned
+  vec b = randn<vec>(2);
+  mat y_hat = X * b;
+  double tau_y(1);
+  BoostRng<boost::minstd_rand> rng;
+  MCModel cold(rng);
+  auto& b_cold = cold.link<Normal>(b, 0, 0.001);
+  cold.link<Uniform>(tau_y, 0, 100);
+  cold.link<Linear>(y_hat, X, b);
+  cold.link<ObservedNormal>(y, y_hat, tau_y);
+  std::vector<vec>& b_cold_hist = cold.track<std::vector>(b);
+  cold.tune(1e4,100);
+  cold.tune_global(1e4,100);
+  cold.burn(1e4);
+  const double saved_scale = b_cold.getScale();
+  const vec saved_b = b;
+  cold.save_tuning(tuning_file);
+  cold.sample(1e5, 10);
+  const vec cold_mean = mean(b_cold_hist.begin(),b_cold_hist.end());
+
+  // warm: a fresh model resumes from the saved scales and state
+  vec b_warm = randn<vec>(2);
+  mat y_hat_warm = X * b_warm;
+  double tau_y_warm(1);
+  MCModel warm(rng);
+  auto& b_warm_node = warm.link<Normal>(b_warm, 0, 0.001);
+  warm.link<Uniform>(tau_y_warm, 0, 100);
+  warm.link<Linear>(y_hat_warm, X, b_warm);
+  warm.link<ObservedNormal>(y, y_hat_warm, tau_y_warm);
+  std::vector<vec>& b_warm_hist = warm.track<std::vector>(b_warm);
+
+  // nothing there, a truncated file, and a file that isn't a tuning file
+  const vec b_before = b_warm;
+  const bool missing = warm.load_tuning("no.such.tuning.file");
+  std::ifstream saved(tuning_file.c_str(), std::ios::binary);
+  const std::string bytes((std::istreambuf_iterator<char>(saved)), std::istreambuf_iterator<char>());
+  std::ofstream(tuning_file + ".truncated", std::ios::binary) << bytes.substr(0, bytes.size() / 2);
+  const bool truncated = warm.load_tuning(tuning_file + ".truncated");
+  std::ofstream(tuning_file + ".garbage", std::ios::binary) << std::string(bytes.size(), 'x');
+  const bool garbage = warm.load_tuning(tuning_file + ".garbage");
+  // a well formed file whose last node has element scales of the wrong size:
+  // rejected before b is retuned
+  const double scale_before = b_warm_node.getScale();
+  BinaryWriter mismatched("CPPBUGSA", 1, warm.structure_key());
+  mismatched.put(static_cast<uint64_t>(2));
+  mismatched.put(0.5);
+  mismatched.put(vec(ones<vec>(2)));
+  mismatched.put(0.5);
+  mismatched.put(vec(ones<vec>(3)));
+  mismatched.put(vec(zeros<vec>(3)));
+  mismatched.write(tuning_file + ".mismatched");
+  const bool mismatch = warm.load_tuning(tuning_file + ".mismatched");
+  std::remove((tuning_file + ".truncated").c_str());
+  std::remove((tuning_file + ".garbage").c_str());
+  std::remove((tuning_file + ".mismatched").c_str());
+  const bool untouched = accu(abs(b_warm - b_before)) == 0 && b_warm_node.getScale() == scale_before &&
+    b_warm_node.getElementScales().n_elem == 0;
+
+  const bool loaded = warm.load_tuning(tuning_file);
+  const bool restored = b_warm_node.getScale() == saved_scale && accu(abs(b_warm - saved_b)) == 0;
+  // no tuning at all, the saved scales are used as they are
+  warm.burn(100);
+  warm.sample(1e5, 10);
+  const vec warm_mean = mean(b_warm_hist.begin(),b_warm_hist.end());
+
+  cout << "load missing, truncated, garbage, mismatched: " << missing << " " << truncated << " " << garbage << " " << mismatch << endl;
+  cout << "load saved: " << loaded << " scale and state restored: " << restored << endl;
+  cout << "b (cold, warm): " << endl << cold_mean.t() << warm_mean.t();
+  cout << "acceptance_ratio (cold, warm): " << cold.acceptance_ratio() << " " << warm.acceptance_ratio() << endl;
+
+  if(missing || truncated || garbage || mismatch || !untouched || !loaded || !restored ||
+     max(abs(cold_mean - warm_mean)) > 0.01 ||
+     std::abs(cold.acceptance_ratio() - warm.acceptance_ratio()) > 0.05) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  std::remove(tuning_file.c_str());
+  return 0;
+};
@@ -0,0 +1,62 @@
+#include <iostream>
+#include <vector>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+int main() {
+  const int NR = 1e2;
+  const int NC = 2;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,NC);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+
+  vec coefs;
+  solve(coefs, X, y);
+
+  // the same model warmed up on convergence and on the fixed schedule of linear.model.test
+  vec b_mean[2];
+  int warmup_iterations(0);
+  for(int adaptive = 1; adaptive >= 0; adaptive--) {
+    vec b = randn<vec>(2);
+    mat y_hat = X * b;
+    double tau_y(1);
+
+    BoostRng<boost::minstd_rand> rng;
+    MCModel m(rng);
+
+    m.link<Normal>(b, 0, 0.001);
+    m.link<Uniform>(tau_y, 0, 100);
+    m.link<Linear>(y_hat, X, b);
+    m.link<ObservedNormal>(y, y_hat, tau_y);
+
+    std::vector<vec>& b_hist = m.track<std::vector>(b);
+
+    if(adaptive) {
+      warmup_iterations = m.warmup(2000, 1e5);
+    } else {
+      m.tune(1e4,100);
+      m.tune_global(1e4,100);
+      m.burn(1e4);
+    }
+    m.sample(1e5, 10);
+    b_mean[adaptive] = mean(b_hist.begin(),b_hist.end());
+  }
+
+  cout << "lm coefs" << endl << coefs;
+  cout << "b (warmup, fixed schedule): " << endl << b_mean[1].t() << b_mean[0].t();
+  cout << "warmup iterations: " << warmup_iterations << " (fixed schedule: 30000)" << endl;
+
+  if(warmup_iterations >= 1e5 || max(abs(b_mean[1] - b_mean[0])) > 0.01) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+};
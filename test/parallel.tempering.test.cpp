@@ -0,0 +1,168 @@
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/mcmc.parallel.tempering.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+#include <cppbugs/distributions/mcmc.wishart.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+template<typename T, typename U>
+class Square : public Deterministic<T> {
+  const U& a_;
+public:
+  Square(T& x, const U& a): Deterministic<T>(x), a_(a) { Deterministic<T>::value = a_*a_; }
+  void jump(RngBase&) { Deterministic<T>::value = a_*a_; }
+};
+
+// throws at the nth jump after being armed
+template<typename T, typename U>
+class Tripwire : public Deterministic<T> {
+  int countdown_;
+public:
+  Tripwire(T& x, const U&): Deterministic<T>(x), countdown_(0) {}
+  void arm(const int n) { countdown_ = n; }
+  void jump(RngBase&) {
+    if(countdown_ > 0 && --countdown_ == 0) { throw std::runtime_error("ERROR: tripwire"); }
+  }
+};
+
+typedef BoostRng<boost::minstd_rand> Rng;
+
+int main() {
+  bool failed = false;
+
+  // y ~ N(mu^2, 1/4): modes at mu = 3 and mu = -3, which a single chain started
+  // at 3 never leaves
+  const vec y_sq = randn<vec>(20) * 0.5 + 9;
+  std::vector<double>* mu_hist = NULL;
+  ParallelTempering<Rng> bimodal([&](MCModel& m, const size_t k) {
+      double& mu = m.make<double>(3.0);
+      double& mu_sq = m.make<double>(9.0);
+      m.link<Normal>(mu, 0, 0.01);
+      m.link<Square>(mu_sq, mu);
+      m.link<ObservedNormal>(y_sq, mu_sq, 4.0);
+      if(k == 0) { mu_hist = &m.track<std::vector>(mu); }
+    }, 8, 1000);
+  bimodal.tune(1e4,100);
+  bimodal.adapt_ladder(2e4);
+  bimodal.tune(1e4,100);
+  bimodal.burn(1e4);
+  bimodal.sample(1e5,10);
+  double positive = 0;
+  for(auto v : *mu_hist) { positive += v > 0; }
+  positive /= mu_hist->size();
+  cout << "bimodal: betas";
+  for(auto b : bimodal.betas()) { cout << " " << b; }
+  cout << endl;
+  cout << "bimodal: swap rates " << bimodal.swap_acceptance().t();
+  cout << "bimodal: share of draws at the positive mode: " << positive << endl;
+  if(positive < 0.3 || positive > 0.7) { failed = true; }
+
+  // a unimodal linear model: the tempered posterior means match plain MH
+  const int NR = 100;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,2);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+  auto linear = [&](MCModel& m, std::vector<vec>*& b_hist, std::vector<double>*& tau_hist) {
+    vec& b = m.make<vec>(zeros<vec>(2));
+    mat& y_hat = m.make<mat>(X * b);
+    double& tau_y = m.make<double>(1.0);
+    m.link<Normal>(b, 0, 0.001);
+    m.link<Uniform>(tau_y, 0, 100);
+    m.link<Linear>(y_hat, X, b);
+    m.link<ObservedNormal>(y, y_hat, tau_y);
+    b_hist = &m.track<std::vector>(b);
+    tau_hist = &m.track<std::vector>(tau_y);
+  };
+
+  std::vector<vec>* b_mh; std::vector<double>* tau_mh;
+  Rng rng;
+  MCModel mh(rng);
+  linear(mh, b_mh, tau_mh);
+  mh.tune(1e4,100);
+  mh.tune_global(1e4,100);
+  mh.burn(1e4);
+  mh.sample(1e5,10);
+
+  std::vector<vec>* b_pt; std::vector<double>* tau_pt;
+  ParallelTempering<Rng> pt([&](MCModel& m, const size_t k) {
+      std::vector<vec>* b_hist; std::vector<double>* tau_hist;
+      linear(m, b_hist, tau_hist);
+      if(k == 0) { b_pt = b_hist; tau_pt = tau_hist; }
+    }, 4, 10);
+  pt.tune(1e4,100);
+  pt.tune_global(1e4,100);
+  pt.burn(1e4);
+  pt.sample(1e5,10);
+
+  const vec b_mean_mh = mean(b_mh->begin(), b_mh->end()), b_mean_pt = mean(b_pt->begin(), b_pt->end());
+  const vec b_se = sqrt(square(mcse(b_mh->begin(), b_mh->end())) + square(mcse(b_pt->begin(), b_pt->end())));
+  const double tau_mean_mh = mean(tau_mh->begin(), tau_mh->end()), tau_mean_pt = mean(tau_pt->begin(), tau_pt->end());
+  const double tau_se = sqrt(pow(mcse(tau_mh->begin(), tau_mh->end()), 2) + pow(mcse(tau_pt->begin(), tau_pt->end()), 2));
+  cout << "linear: b (mh) " << b_mean_mh.t() << "linear: b (pt) " << b_mean_pt.t();
+  cout << "linear: tau (mh) " << tau_mean_mh << " tau (pt) " << tau_mean_pt << endl;
+  cout << "linear: swap rates " << pt.swap_acceptance().t();
+  // within 4 standard errors of the difference
+  if(accu(abs(b_mean_pt - b_mean_mh) > 4 * b_se) > 0 || std::abs(tau_mean_pt - tau_mean_mh) > 4 * tau_se) { failed = true; }
+
+  // no swaps attempted yet: rates are 0, not nan
+  ParallelTempering<Rng> fresh([&](MCModel& m, const size_t) {
+      double& mu = m.make<double>(0.0);
+      m.link<Normal>(mu, 0, 1.0);
+    }, 3);
+  cout << "fresh: swap rates " << fresh.swap_acceptance().t();
+  if(accu(abs(fresh.swap_acceptance())) != 0) { failed = true; }
+
+  // a replica throwing part way through a run abandons its exchanges; the next
+  // run must neither match their stale rounds nor hang on them
+  Tripwire<double, double>* tripwire = NULL;
+  std::vector<double>* recovered_hist = NULL;
+  ParallelTempering<Rng> recovering([&](MCModel& m, const size_t k) {
+      double& mu = m.make<double>(0.0);
+      double& trip = m.make<double>(0.0);
+      m.link<Normal>(mu, 0, 1.0);
+      auto& t = m.link<Tripwire>(trip, mu);
+      if(k == 1) { tripwire = &t; }
+      if(k == 0) { recovered_hist = &m.track<std::vector>(mu); }
+    }, 4, 10, 1);
+  tripwire->arm(1005);
+  try {
+    recovering.sample(1e4, 1);
+    cout << "the tripwire didn't throw" << endl;
+    failed = true;
+  } catch(std::runtime_error& e) {
+    cout << "replica threw: " << e.what() << endl;
+  }
+  recovered_hist->clear();
+  recovering.sample(1e5, 10);
+  const double recovered_mean = mean(recovered_hist->begin(), recovered_hist->end());
+  cout << "after the throw: draws " << recovered_hist->size() << " mean " << recovered_mean << " swap rates " << recovering.swap_acceptance().t();
+  if(recovered_hist->size() != 10000 || std::abs(recovered_mean) > 0.1) { failed = true; }
+
+  // swaps exchange the flat state, which doesn't hold a Wishart node
+  try {
+    const mat sigma_prior = eye(2,2);
+    ParallelTempering<Rng> bad([&](MCModel& m, const size_t) {
+        mat& sigma = m.make<mat>(eye(2,2));
+        m.link<Wishart>(sigma, sigma_prior, 5.0);
+      }, 2);
+    cout << "a Wishart node was accepted" << endl;
+    failed = true;
+  } catch(std::logic_error& e) {
+    cout << "rejected: " << e.what() << endl;
+  }
+
+  if(failed) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+}
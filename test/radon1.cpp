@@ -10,7 +10,7 @@
 #include <cppbugs/cppbugs.hpp>
 #include <cppbugs/mcmc.boost.rng.hpp>
 #include <cppbugs/deterministics/mcmc.linear.with.const.hpp>
-#include <cppbugs/deterministics/mcmc.inv.variance.hpp>
+#include <cppbugs/deterministics/mcmc.gather.hpp>
 
 using namespace arma;
 using namespace cppbugs;
@@ -20,7 +20,6 @@ using std::cout;
 using std::endl;
 using std::ifstream;
 
-typedef arma::subview_elem1<double, arma::Mat<uword> > replicatedT;
 
 /*
 # Bugs code for multilevel model for radon
@@ -111,23 +110,27 @@ int main() {
 
   vec a(randn<vec>(group.max() + 1));
   double b, tau_y(1), sigma_y(1), mu_a, tau_a(1), sigma_a(1);
-  replicatedT a_full = a.elem(group);
+  vec a_full;
   mat y_hat;
 
+  // tau = 1/sigma^2, evaluated in place
+  auto inv_variance = [](double& tau, const double& sigma) { tau = 1/(sigma*sigma); };
+
   BoostRng<boost::minstd_rand> rng;
   MCModel m(rng);
 
   m.link<Uniform>(sigma_a, 0, 100);
-  m.link<InvVariance>(tau_a,sigma_a);
+  m.lambda_inplace(tau_a,inv_variance,sigma_a);
   m.link<Normal>(mu_a, 0, 0.001);
   m.link<Normal>(a, mu_a, tau_a);
+  m.link<Gather>(a_full, a, group);
 
   m.link<Normal>(b, 0, 0.001);
 
   m.link<LinearWithConst>(y_hat,basement,a_full,b);
 
   m.link<Uniform>(sigma_y, 0, 100);
-  m.link<InvVariance>(tau_y,sigma_y);
+  m.lambda_inplace(tau_y,inv_variance,sigma_y);
 
   m.link<ObservedNormal>(level_const, y_hat, tau_y);
 
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <vector>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+// sees every proposal: records where the node's value lived and what it held
+template<typename T, typename U>
+class Probe : public Deterministic<T> {
+  const U& a_;
+public:
+  const double* seen_at;
+  U seen;
+  Probe(T& x, const U& a): Deterministic<T>(x), a_(a), seen_at(NULL) {}
+  void jump(RngBase&) {
+    seen_at = a_.memptr();
+    seen = a_;
+  }
+};
+
+// packed nodes take a proposal by swapping in the buffer it was written to,
+// and a rejection swaps back: the value the chain stays at is never copied
+int main() {
+  const int N = 100;
+  vec b = zeros<vec>(N);
+  double probed(0);
+  const vec y = randn<vec>(N);
+
+  BoostRng<boost::minstd_rand> rng;
+  MCModel m(rng);
+  auto& b_node = m.link<Normal>(b, 0, 1.0);
+  auto& probe = m.link<Probe>(probed, b);
+  m.link<ObservedNormal>(y, b, 1.0);
+
+  bool failed = false;
+
+  // a tiny scale to settle logp, then a huge one: every proposal is rejected
+  b_node.setScale(1e-6);
+  m.step();
+  b_node.setScale(1e3);
+  const double* home = b.memptr();
+  const vec before = b;
+  m.resetAcceptanceRatio();
+  m.step();
+  cout << "rejected step: acceptance " << m.acceptance_ratio() << endl;
+  if(m.acceptance_ratio() != 0) { failed = true; }
+  if(probe.seen_at == home) {
+    cout << "the proposal was written into the current value" << endl;
+    failed = true;
+  }
+  if(b.memptr() != home || accu(abs(b - before)) != 0) {
+    cout << "the rejection moved or changed the current value" << endl;
+    failed = true;
+  }
+  if(b_node.old_value.memptr() != probe.seen_at || accu(abs(b_node.old_value - probe.seen)) != 0) {
+    cout << "the rejected proposal was not swapped out" << endl;
+    failed = true;
+  }
+
+  // a tiny scale: the proposal is accepted and its buffer becomes the value
+  b_node.setScale(1e-6);
+  m.resetAcceptanceRatio();
+  m.step();
+  cout << "accepted step: acceptance " << m.acceptance_ratio() << endl;
+  if(m.acceptance_ratio() != 1 || b.memptr() != probe.seen_at || accu(abs(b - probe.seen)) != 0) {
+    cout << "the accepted proposal is not the value" << endl;
+    failed = true;
+  }
+
+  // flat_ isn't refreshed every step: a value set by hand is picked up by the next run
+  b.fill(5);
+  m.burn(1);
+  cout << "after setting b by hand: max |b - 5| " << max(abs(b - 5)) << endl;
+  if(max(abs(b - 5)) > 1e-3) { failed = true; }
+
+  if(failed) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/mcmc.sequential.monte.carlo.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+#include <cppbugs/distributions/mcmc.wishart.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+typedef BoostRng<boost::minstd_rand> Rng;
+
+int main() {
+  bool failed = false;
+
+  // y ~ N(mu, 1), mu ~ N(0, 100): the marginal likelihood and posterior are known
+  const int N = 20;
+  const double v0 = 100;
+  const vec y_conj = randn<vec>(N) + 3;
+  std::vector<double>* mu_hist = NULL;
+  SequentialMonteCarlo<Rng> conjugate([&](MCModel& m, const size_t t) {
+      double& mu = m.make<double>(0.0);
+      m.link<Normal>(mu, 0, 1 / v0);
+      m.link<ObservedNormal>(y_conj, mu, 1.0);
+      if(t == 0) { mu_hist = &m.track<std::vector>(mu); }
+    }, 2000);
+  const double log_z = conjugate.run();
+  const double s = accu(y_conj), ss = accu(y_conj % y_conj);
+  const double log_z_exact = -N / 2.0 * log(2 * M_PI) - 0.5 * log(1 + N * v0) - 0.5 * (ss - v0 / (1 + N * v0) * s * s);
+  const double mu_mean_exact = v0 * s / (1 + N * v0);
+  const double mu_mean = mean(mu_hist->begin(), mu_hist->end());
+  cout << "conjugate: log evidence " << log_z << " exact " << log_z_exact << " (" << conjugate.betas().size() - 1 << " tempering steps)" << endl;
+  cout << "conjugate: posterior mean " << mu_mean << " exact " << mu_mean_exact << endl;
+  // over seeds the log evidence has an sd of about 0.025 here; the posterior sd is 1 / sqrt(N + 1 / v0)
+  if(std::abs(log_z - log_z_exact) > 0.1 || std::abs(mu_mean - mu_mean_exact) > 0.1 / sqrt(N + 1 / v0)) { failed = true; }
+
+  const int NR = 100;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,2);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+  auto linear = [&](MCModel& m) -> std::vector<vec>& {
+    vec& b = m.make<vec>(zeros<vec>(2));
+    mat& y_hat = m.make<mat>(X * b);
+    double& tau_y = m.make<double>(1.0);
+    m.link<Normal>(b, 0, 0.001);
+    m.link<Uniform>(tau_y, 0, 100);
+    m.link<Linear>(y_hat, X, b);
+    m.link<ObservedNormal>(y, y_hat, tau_y);
+    return m.track<std::vector>(b);
+  };
+
+  Rng rng;
+  MCModel mh(rng);
+  std::vector<vec>& b_mh = linear(mh);
+  mh.tune(1e4,100);
+  mh.tune_global(1e4,100);
+  mh.burn(1e4);
+  mh.sample(1e5,10);
+
+  // the same run on 1 and 4 threads: all draws are made on the calling thread
+  vec b_mean[2];
+  mat particles[2];
+  for(int run = 0; run < 2; run++) {
+    std::vector<vec>* b_smc = NULL;
+    SequentialMonteCarlo<Rng> smc([&](MCModel& m, const size_t t) {
+        std::vector<vec>& b_hist = linear(m);
+        if(t == 0) { b_smc = &b_hist; }
+      }, 2000, run ? 4 : 1);
+    smc.run();
+    b_mean[run] = mean(b_smc->begin(), b_smc->end());
+    particles[run] = smc.particles();
+    cout << "smc (" << (run ? 4 : 1) << " threads): b " << b_mean[run].t();
+    cout << "smc: log evidence " << smc.log_evidence() << " tempering steps " << smc.betas().size() - 1 << " acceptance " << smc.acceptance_ratio() << endl;
+  }
+  const vec b_mean_mh = mean(b_mh.begin(), b_mh.end());
+  const vec b_sd = sd(b_mh.begin(), b_mh.end());
+  cout << "mh: b " << b_mean_mh.t();
+  // within a tenth of a posterior sd
+  if(accu(abs(b_mean[0] - b_mean_mh) > 0.1 * b_sd) > 0) { failed = true; }
+  if(accu(abs(particles[0] - particles[1])) != 0) {
+    cout << "thread count changed the particles" << endl;
+    failed = true;
+  }
+
+  // logp is evaluated at a flat state, which doesn't hold a Wishart node
+  try {
+    const mat sigma_prior = eye(2,2);
+    SequentialMonteCarlo<Rng> bad([&](MCModel& m, const size_t) {
+        mat& sigma = m.make<mat>(eye(2,2));
+        m.link<Wishart>(sigma, sigma_prior, 5.0);
+      }, 100);
+    cout << "a Wishart node was accepted" << endl;
+    failed = true;
+  } catch(std::logic_error& e) {
+    cout << "rejected: " << e.what() << endl;
+  }
+
+  if(failed) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+}
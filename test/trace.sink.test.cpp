@@ -0,0 +1,128 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <stdexcept>
+#include <armadillo>
+#include <cppbugs/cppbugs.hpp>
+#include <cppbugs/mcmc.boost.rng.hpp>
+#include <cppbugs/mcmc.trace.sink.hpp>
+#include <cppbugs/deterministics/mcmc.linear.hpp>
+
+using namespace arma;
+using namespace cppbugs;
+using std::cout;
+using std::endl;
+
+int main() {
+  const int NR = 1e2;
+  const int NC = 2;
+  const mat y = randn<mat>(NR,1) + 10;
+  mat X = mat(NR,NC);
+  X.col(0).fill(1);
+  X.col(1) = y + randn<mat>(NR,1)/2 - 10;
+
+  vec b = randn<vec>(2);
+  mat y_hat = X * b;
+  double tau_y(1);
+
+  BoostRng<boost::minstd_rand> rng;
+  MCModel m(rng);
+
+  m.link<Normal>(b, 0, 0.001);
+  m.link<Uniform>(tau_y, 0, 100);
+  m.link<Linear>(y_hat, X, b);
+  m.link<ObservedNormal>(y, y_hat, tau_y);
+
+  // a small ring so the sampler has to wait on the writer now and then
+  size_t n_records(0);
+  vec record_sum = zeros<vec>(3);
+  TraceSink sink([&](const double* record, const size_t width) {
+      n_records++;
+      for(size_t i = 0; i < width; i++) { record_sum[i] += record[i]; }
+    }, 64);
+  sink.add(b).add(tau_y);
+  TraceSink file_sink("trace.sink.test.bin");
+  file_sink.add(b);
+
+  m.track(sink);
+  m.track(file_sink);
+  std::vector<vec>& b_hist = m.track<std::vector>(b);
+  std::vector<double>& tau_y_hist = m.track<std::vector>(tau_y);
+
+  m.tune(1e4,100);
+  m.tune_global(1e4,100);
+  m.burn(1e4);
+  m.sample(1e5, 10);
+  sink.close();
+  file_sink.close();
+
+  const vec b_mean = mean(b_hist.begin(),b_hist.end());
+  const double tau_y_mean = mean(tau_y_hist.begin(),tau_y_hist.end());
+  cout << "b (history, sink): " << endl << b_mean.t() << record_sum.rows(0,1).t() / n_records;
+  cout << "tau_y (history, sink): " << tau_y_mean << " " << record_sum[2] / n_records << endl;
+  cout << "records: " << n_records << endl;
+
+  std::ifstream trace("trace.sink.test.bin", std::ios::binary);
+  vec file_sum = zeros<vec>(2);
+  double draw[2];
+  size_t n_file(0);
+  while(trace.read(reinterpret_cast<char*>(draw), sizeof(draw))) {
+    file_sum[0] += draw[0];
+    file_sum[1] += draw[1];
+    n_file++;
+  }
+  cout << "file records: " << n_file << endl;
+
+  bool ok = n_records == b_hist.size() && n_file == b_hist.size() &&
+    max(abs(record_sum.rows(0,1) / n_records - b_mean)) < 1e-8 &&
+    max(abs(file_sum / n_file - b_mean)) < 1e-8 &&
+    std::abs(record_sum[2] / n_records - tau_y_mean) < 1e-8;
+
+  // tracking into a closed sink is an error
+  try {
+    sink.track();
+    ok = false;
+  } catch(std::logic_error& e) {
+    cout << "closed sink: " << e.what() << endl;
+  }
+
+  // a ring with no room, or records with nothing in them, can't be drained
+  try {
+    TraceSink empty_ring([](const double*, const size_t) {}, 0);
+    ok = false;
+  } catch(std::logic_error& e) {
+    cout << "zero capacity: " << e.what() << endl;
+  }
+  try {
+    TraceSink no_fields([](const double*, const size_t) {});
+    no_fields.track();
+    ok = false;
+  } catch(std::logic_error& e) {
+    cout << "zero width: " << e.what() << endl;
+  }
+
+  // a failing consumer is reported on the sampling thread instead of stalling it
+  MCModel failing(rng);
+  failing.link<Normal>(b, 0, 0.001);
+  failing.link<Uniform>(tau_y, 0, 100);
+  failing.link<Linear>(y_hat, X, b);
+  failing.link<ObservedNormal>(y, y_hat, tau_y);
+  size_t n_failing(0);
+  TraceSink failing_sink([&](const double*, const size_t) {
+      if(++n_failing > 10) { throw std::runtime_error("ERROR: consumer failed"); }
+    }, 4);
+  failing_sink.add(b);
+  failing.track(failing_sink);
+  try {
+    failing.sample(1e4, 1);
+    ok = false;
+  } catch(std::runtime_error& e) {
+    cout << "failed consumer: " << e.what() << endl;
+  }
+
+  if(!ok) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  return 0;
+};